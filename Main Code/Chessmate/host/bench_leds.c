@@ -0,0 +1,124 @@
+// bench_leds.c
+// Cost of encoding a full 64 LED frame from the precomputed gamma/brightness
+// tables, against working out every bit per frame. The wire is simulated
+// here, so commit time is the CPU side only; the board runs the same
+// benchmark against the real strip with CONFIG_CHESSMATE_ENGINE_BENCH.
+// Then checks that bursts of posts between frame ticks send one frame per
+// tick, and times the layer compositor against a per-square reference.
+//
+//   bench_leds [rounds]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "time_us.h"
+#include "led_display.h"
+#include "led_hw.h"
+#include "led_compose.h"
+
+static size_t symbols_sent;
+
+// Per square: the highest priority layer covering it
+static void compose_per_square(const uint64_t *layers, const led_color_t *colors, led_color_t *frame) {
+    for (int sq = 0; sq < LED_COUNT; sq++) {
+        int best = -1;
+        for (int layer = 0; layer < LED_LAYER_COUNT; layer++) {
+            if (((layers[layer] >> sq) & 1) &&
+                (best < 0 || led_layer_styles[layer].priority > led_layer_styles[best].priority)) {
+                best = layer;
+            }
+        }
+        frame[sq] = (best < 0) ? LED_OFF : colors[best];
+    }
+}
+
+static uint64_t rng_next(void) {
+    static uint64_t state = 0x9E3779B97F4A7C15ULL;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+void led_hw_init(void) {
+}
+
+void led_hw_transmit(const uint32_t *symbols, size_t count) {
+    (void)symbols;
+    symbols_sent += count;
+}
+
+void led_hw_wait_done(void) {
+}
+
+int main(int argc, char **argv) {
+    int rounds = argc > 1 ? atoi(argv[1]) : 100000;
+    static const uint8_t levels[] = { LED_BRIGHTNESS_LOW, LED_BRIGHTNESS_MED, LED_BRIGHTNESS_HIGH };
+    int failed = 0;
+
+    led_display_init();
+    for (size_t i = 0; i < sizeof(levels); i++) {
+        led_bench_t bench;
+        led_set_brightness(levels[i]);
+        led_commit();
+        led_display_bench(rounds, &bench);
+        printf("brightness %3u: encode %6.2f us from tables, %6.2f us per bit, commit %.2f us, wire %lld us%s\n",
+               levels[i], bench.encode_ns / 1000.0, bench.encode_per_bit_ns / 1000.0,
+               bench.commit_ns / 1000.0, (long long)bench.wire_us, bench.mismatches ? ", MISMATCH" : "");
+        failed |= bench.mismatches != 0;
+    }
+    printf("%zu symbols sent\n", symbols_sent);
+
+    // A burst of posts between frame ticks must still go out as one frame per tick
+    led_stats_t before, after;
+    led_get_stats(&before);
+    int64_t now_us = 0;
+    int frames = 1000;
+    int64_t start = time_now_us();
+    for (int f = 0; f < frames; f++) {
+        for (int i = 0; i < 20; i++) {
+            led_post(LED_LAYER_TARGETS, 0x0000FF0000000000ULL >> ((f + i) & 31));
+        }
+        led_post(LED_LAYER_CHECK, 1ULL << 4);
+        led_scheduler_frame(now_us += 1000000 / LED_FRAME_HZ);
+    }
+    int64_t elapsed_us = time_now_us() - start;
+    led_get_stats(&after);
+    uint32_t transmits = after.transmits - before.transmits;
+    printf("%d ticks: %u posts, %u coalesced, %u frames sent, %.2f us per tick\n", frames,
+           after.posts - before.posts, after.coalesced - before.coalesced, transmits, (double)elapsed_us / frames);
+    failed |= transmits > (uint32_t)frames;
+
+    // Compositor on overlapping random layers
+    enum { LAYER_SETS = 64 };
+    static uint64_t layer_sets[LAYER_SETS][LED_LAYER_COUNT];
+    led_color_t colors[LED_LAYER_COUNT];
+    for (int layer = 0; layer < LED_LAYER_COUNT; layer++) {
+        colors[layer] = led_layer_styles[layer].color;
+    }
+    for (int set = 0; set < LAYER_SETS; set++) {
+        for (int layer = 0; layer < LED_LAYER_COUNT; layer++) {
+            layer_sets[set][layer] = rng_next() & rng_next();
+        }
+    }
+    led_color_t frame[LED_COUNT], reference[LED_COUNT];
+    int mismatches = 0;
+    for (int set = 0; set < LAYER_SETS; set++) {
+        led_compose(layer_sets[set], colors, frame);
+        compose_per_square(layer_sets[set], colors, reference);
+        mismatches += memcmp(frame, reference, sizeof(frame)) != 0;
+    }
+    start = time_now_us();
+    for (int r = 0; r < rounds; r++) {
+        led_compose(layer_sets[r & (LAYER_SETS - 1)], colors, frame);
+    }
+    double compose_ns = (time_now_us() - start) * 1000.0 / rounds;
+    start = time_now_us();
+    for (int r = 0; r < rounds; r++) {
+        compose_per_square(layer_sets[r & (LAYER_SETS - 1)], colors, reference);
+    }
+    double per_square_ns = (time_now_us() - start) * 1000.0 / rounds;
+    printf("compose %d layers: %.0f ns by bitboard, %.0f ns per square, %d mismatches\n", LED_LAYER_COUNT,
+           compose_ns, per_square_ns, mismatches);
+    failed |= mismatches != 0;
+    return failed;
+}
@@ -0,0 +1,22 @@
+// bench_moves.c
+// Cost per move of make/unmake with incremental attack maps, against
+// rebuilding the maps from scratch. The board runs the same benchmark at boot
+// with CONFIG_CHESSMATE_ENGINE_BENCH.
+//
+//   bench_moves [rounds]
+#include <stdio.h>
+#include <stdlib.h>
+#include "engine_bench.h"
+
+int main(int argc, char **argv) {
+    int rounds = argc > 1 ? atoi(argv[1]) : 20000;
+    attack_bench_t bench;
+
+    engine_bench_attack_maps(rounds, &bench);
+    printf("%u moves\n", bench.moves);
+    printf("make + unmake:        %7.1f ns per move\n", bench.make_unmake_us * 1000.0 / bench.moves);
+    printf("  with the maps off:  %7.1f ns per move\n", bench.plain_us * 1000.0 / bench.moves);
+    printf("maps from scratch:    %7.1f ns per position\n", bench.recompute_us * 1000.0 / bench.moves);
+    printf("incremental mismatches: %u\n", bench.mismatches);
+    return bench.mismatches ? 1 : 0;
+}
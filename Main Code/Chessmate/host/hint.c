@@ -0,0 +1,35 @@
+// hint.c
+// Runs the "Assist: High" hint search from the command line.
+//
+//   hint [fen] [budget_ms]
+#include <stdio.h>
+#include <stdlib.h>
+#include "search.h"
+#include "transposition.h"
+
+#define START_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+
+int main(int argc, char **argv) {
+    static position_t pos;
+    const char *fen = argc > 1 ? argv[1] : START_FEN;
+    int64_t budget_us = argc > 2 ? atoll(argv[2]) * 1000 : search_budget_us(180);
+
+    if (!position_from_fen(&pos, fen)) {
+        fprintf(stderr, "invalid FEN\n");
+        return 2;
+    }
+
+    search_result_t result;
+    char text[6];
+    search_arm();
+    search_hint(&pos, budget_us, &result);
+    move_to_string(result.best_move, text);
+    printf("Hint: %s  score %d  depth %d  nodes %u  time %.1f ms%s\n", text, result.score, result.depth,
+           result.nodes, result.elapsed_us / 1000.0, result.stopped ? "  (stopped at deadline)" : "");
+
+    tt_stats_t stats;
+    tt_get_stats(&stats);
+    printf("TT: %zu KB  probes %u  hits %u  stores %u  collisions %u  fill %u/1000\n", stats.bytes / 1024,
+           stats.probes, stats.hits, stats.stores, stats.collisions, stats.fill_permille);
+    return 0;
+}
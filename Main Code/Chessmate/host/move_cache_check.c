@@ -0,0 +1,91 @@
+// move_cache_check.c
+// Plays games through the legal target cache the way game.c does and checks
+// its counters: lookups between moves are hits, and the table is rebuilt once
+// per new position however often it is updated or read. Every entry is also
+// compared with a fresh generator pass. Exits non-zero on any mismatch.
+//
+//   move_cache_check [games]
+#include <stdio.h>
+#include <stdlib.h>
+#include "move_cache.h"
+
+#define MAX_PLIES 200
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint32_t next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)(rng_state >> 32);
+}
+
+static int failures;
+
+static void expect(bool ok, const char *what, int game, int ply) {
+    if (!ok) {
+        if (failures < 10) {
+            printf("FAIL game %d ply %d: %s\n", game, ply, what);
+        }
+        failures++;
+    }
+}
+
+int main(int argc, char **argv) {
+    static position_t pos;
+    static move_cache_t cache;
+    static move_list_t list;
+    uint64_t expected[64];
+    int games = argc > 1 ? atoi(argv[1]) : 20;
+    int plies = 0;
+
+    for (int g = 0; g < games; g++) {
+        position_set_start(&pos);
+        move_cache_init(&cache);
+        move_cache_update(&cache, &pos);
+        expect(cache.rebuilds == 1 && cache.hits == 0, "first update did not build once", g, 0);
+
+        for (int ply = 0; ply < MAX_PLIES; ply++) {
+            uint32_t hits = cache.hits;
+            uint32_t rebuilds = cache.rebuilds;
+
+            // A second update and every lookup on the same position are free
+            move_cache_update(&cache, &pos);
+            for (int i = 0; i < 2; i++) {
+                for (int sq = 0; sq < 64; sq++) {
+                    move_cache_targets(&cache, &pos, sq);
+                }
+            }
+            expect(cache.rebuilds == rebuilds, "rebuilt without a key change", g, ply);
+            expect(cache.hits == hits + 128, "lookups between moves were not hits", g, ply);
+
+            for (int sq = 0; sq < 64; sq++) {
+                expected[sq] = 0;
+            }
+            generate_legal_targets(&pos, expected);
+            for (int sq = 0; sq < 64; sq++) {
+                expect(move_cache_targets(&cache, &pos, sq) == expected[sq], "stale targets", g, ply);
+            }
+
+            generate_legal_moves(&pos, &list);
+            if (list.count == 0) {
+                break;
+            }
+            make_move(&pos, list.moves[next_random() % list.count]);
+            plies++;
+
+            // One commit, one rebuild
+            move_cache_update(&cache, &pos);
+            expect(cache.rebuilds == rebuilds + 1, "key change did not rebuild exactly once", g, ply);
+        }
+
+        // A reset table is rebuilt even though the key is unchanged
+        uint32_t rebuilds = cache.rebuilds;
+        move_cache_invalidate(&cache);
+        move_cache_targets(&cache, &pos, 0);
+        expect(cache.rebuilds == rebuilds + 1, "invalidate did not force a rebuild", g, MAX_PLIES);
+    }
+
+    printf("%d games, %d plies: %s\n", games, plies, failures ? "FAILED" : "cache counters OK");
+    return failures ? 1 : 0;
+}
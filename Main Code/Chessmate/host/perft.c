@@ -0,0 +1,167 @@
+// perft.c
+// Counts the leaf nodes of the legal move tree to check calculate_moves.c
+// against published node counts, and reports generator throughput.
+//
+//   perft                      run the standard position suite
+//   perft quick                run the suite at depth 3 with Zobrist key checks, for ctest
+//   perft <depth> [fen]        count nodes from one position
+//   perft divide <depth> [fen] count nodes below each root move
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "calculate_moves.h"
+
+#define START_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+
+typedef struct {
+    const char *name;
+    const char *fen;
+    int depth;
+    uint64_t nodes;
+    uint64_t quick_nodes;       // at QUICK_DEPTH
+} perft_case_t;
+
+#define QUICK_DEPTH 3
+
+// Reference counts from https://www.chessprogramming.org/Perft_Results
+static const perft_case_t suite[] = {
+    {"start", START_FEN, 5, 4865609, 8902},
+    {"kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 4, 4085603, 97862},
+    {"position 3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 6, 11030083, 2812},
+    {"position 4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 5, 15833292, 9467},
+    {"position 4 mirrored", "r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1", 5, 15833292, 9467},
+    {"position 5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 4, 2103487, 62379},
+    {"position 6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 4, 3894594, 89890},
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Moves at the last ply are counted without being played (bulk counting)
+static uint64_t perft(position_t *pos, int depth) {
+    move_list_t list;
+    int count = generate_legal_moves(pos, &list);
+    if (depth <= 1) {
+        return depth == 1 ? (uint64_t)count : 1;
+    }
+
+    uint64_t nodes = 0;
+    for (int i = 0; i < count; i++) {
+        make_move(pos, list.moves[i]);
+        nodes += perft(pos, depth - 1);
+        unmake_move(pos);
+    }
+    return nodes;
+}
+
+// Plays every move, leaves included, and compares the incremental Zobrist key
+// with one computed from scratch after each make and unmake. Slower than
+// perft(), so only the quick suite uses it.
+static uint64_t perft_keys(position_t *pos, int depth, uint64_t *key_errors) {
+    if (depth == 0) {
+        return 1;
+    }
+    move_list_t list;
+    int count = generate_legal_moves(pos, &list);
+    uint64_t nodes = 0;
+    for (int i = 0; i < count; i++) {
+        make_move(pos, list.moves[i]);
+        *key_errors += pos->key != position_compute_key(pos);
+        nodes += perft_keys(pos, depth - 1, key_errors);
+        unmake_move(pos);
+        *key_errors += pos->key != position_compute_key(pos);
+    }
+    return nodes;
+}
+
+static uint64_t divide(position_t *pos, int depth) {
+    move_list_t list;
+    uint64_t total = 0;
+    generate_legal_moves(pos, &list);
+    for (int i = 0; i < list.count; i++) {
+        char text[6];
+        make_move(pos, list.moves[i]);
+        uint64_t nodes = perft(pos, depth - 1);
+        unmake_move(pos);
+        move_to_string(list.moves[i], text);
+        printf("%s: %llu\n", text, (unsigned long long)nodes);
+        total += nodes;
+    }
+    printf("\nMoves: %d\n", list.count);
+    return total;
+}
+
+static void report(uint64_t nodes, double elapsed) {
+    printf("Nodes: %llu  Time: %.3f s  NPS: %.0f\n", (unsigned long long)nodes, elapsed,
+           elapsed > 0 ? nodes / elapsed : 0.0);
+}
+
+static int run_suite(bool quick) {
+    uint64_t total_nodes = 0;
+    double total_time = 0;
+    int failures = 0;
+
+    for (size_t i = 0; i < sizeof(suite) / sizeof(suite[0]); i++) {
+        static position_t pos;
+        int depth = quick ? QUICK_DEPTH : suite[i].depth;
+        uint64_t expected = quick ? suite[i].quick_nodes : suite[i].nodes;
+        if (!position_from_fen(&pos, suite[i].fen)) {
+            printf("%-20s invalid FEN  FAIL\n", suite[i].name);
+            failures++;
+            continue;
+        }
+
+        uint64_t key_errors = 0;
+        double start = now_seconds();
+        uint64_t nodes = quick ? perft_keys(&pos, depth, &key_errors) : perft(&pos, depth);
+        double elapsed = now_seconds() - start;
+
+        bool ok = nodes == expected && key_errors == 0;
+        failures += !ok;
+        total_nodes += nodes;
+        total_time += elapsed;
+        printf("%-20s depth %d  %12llu  %s  %6.1f M nodes/s\n", suite[i].name, depth,
+               (unsigned long long)nodes, ok ? "ok  " : "FAIL", elapsed > 0 ? nodes / elapsed / 1e6 : 0.0);
+        if (nodes != expected) {
+            printf("    expected %llu\n", (unsigned long long)expected);
+        }
+        if (key_errors) {
+            printf("    %llu incremental Zobrist keys differ from position_compute_key()\n",
+                   (unsigned long long)key_errors);
+        }
+    }
+    printf("\n");
+    report(total_nodes, total_time);
+    printf("%d of %d positions failed\n", failures, (int)(sizeof(suite) / sizeof(suite[0])));
+    return failures ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2 || strcmp(argv[1], "quick") == 0) {
+        return run_suite(argc >= 2);
+    }
+
+    bool split = strcmp(argv[1], "divide") == 0;
+    int arg = split ? 2 : 1;
+    if (arg >= argc) {
+        fprintf(stderr, "usage: %s [divide] <depth> [fen]\n", argv[0]);
+        return 2;
+    }
+    int depth = atoi(argv[arg]);
+    const char *fen = (arg + 1 < argc) ? argv[arg + 1] : START_FEN;
+
+    static position_t pos;
+    if (depth < 1 || !position_from_fen(&pos, fen)) {
+        fprintf(stderr, "invalid depth or FEN\n");
+        return 2;
+    }
+
+    double start = now_seconds();
+    uint64_t nodes = split ? divide(&pos, depth) : perft(&pos, depth);
+    report(nodes, now_seconds() - start);
+    return 0;
+}
@@ -0,0 +1,37 @@
+// prototype_cases.c
+// Replays the piece tests from available_moves.py through the C generator and
+// prints the boards in the same format, so the two outputs can be diffed.
+#include <stdio.h>
+#include "calculate_moves.h"
+
+static void print_board(int piece_sq, uint64_t targets) {
+    for (int row = 0; row < 8; row++) {
+        for (int col = 0; col < 8; col++) {
+            int sq = SQUARE(row, col);
+            if (sq == piece_sq) {
+                printf("X ");
+            } else {
+                printf("%d ", (targets & SQUARE_BB(sq)) ? 1 : 0);
+            }
+        }
+        printf("\n");
+    }
+}
+
+static void run_case(const char *name, piece_type_t type, int row, int col) {
+    position_t pos;
+    position_clear(&pos);
+    position_put_piece(&pos, WHITE, type, SQUARE(row, col));
+
+    printf("%s test: \n", name);
+    print_board(SQUARE(row, col), piece_targets(&pos, SQUARE(row, col)));
+}
+
+int main(void) {
+    run_case("King", KING, 0, 0);
+    run_case("Rook", ROOK, 4, 4);
+    run_case("Knight", KNIGHT, 3, 1);
+    run_case("Bishop", BISHOP, 5, 5);
+    run_case("Queen", QUEEN, 3, 5);
+    return 0;
+}
@@ -0,0 +1,421 @@
+// scan_sim.c
+// Runs the board scanner (scan_core.c) against a simulated mux and hall
+// sensors on a virtual clock, so scan-to-event latency and move recognition
+// can be measured without a board.
+//
+//   scan_sim [options] [trace]
+//
+//   trace              replay piece movements from a file, one per line:
+//                      "<ms> lift|place <square>", or the "LIFT e2 at <us> us"
+//                      lines the board firmware logs
+//   --games <n>        play n random legal games instead (default 100)
+//   --noise <p>        chance that any single sample reads wrong (default 0)
+//   --bounce <ms>      readings are random for this long after a change (default 0)
+//   --lag <n>          process finished sweeps only every n sweeps (default 1)
+//   --speed <x>        run at x times real time instead of as fast as possible
+//   --seed <n>         random seed (default 1)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "scan_board.h"
+#include "scan_hw.h"
+#include "board_events.h"
+#include "move_infer.h"
+#include "debounce.h"
+
+#define START_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+#define MAX_ACTIONS 4096
+#define MAX_GAME_PLIES 200
+#define LATENCY_BUCKET_MS 5
+#define LATENCY_BUCKETS 200
+
+typedef struct {
+    int64_t time_us;
+    board_event_type_t type;
+    uint8_t square;
+} action_t;
+
+// Simulated hardware
+static int64_t sim_time_us;
+static uint32_t sim_period_us;
+static uint8_t selected_sq;
+static uint64_t pieces;                     // where pieces really are
+static int64_t changed_at_us[64];           // last time each square changed
+static double noise;
+static int64_t bounce_us;
+static uint64_t samples;
+static uint64_t mux_toggles;
+static uint64_t rng_state = 1;
+
+// Scripted movements, applied in time order
+static action_t actions[MAX_ACTIONS];
+static int action_count;
+
+// Latency from a physical change to its board event
+static int64_t pending_since[2][64];      // by event type, -1 when none is pending
+static uint32_t latency_hist[LATENCY_BUCKETS + 1];
+static uint32_t latency_count;
+static int64_t latency_sum_us;
+static int64_t latency_max_us;
+static uint32_t unmatched_events;
+
+// Move recognition check for random games
+static position_t pos;
+static move_infer_t infer;
+static move_t expected[MAX_GAME_PLIES];
+static int expected_count;
+static int recognised;
+static uint32_t illegal_reports;
+static uint32_t wrong_moves;
+
+static uint64_t rng_next(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static double rng_unit(void) {
+    return (rng_next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static int64_t rng_range(int64_t lo, int64_t hi) {
+    return lo + (int64_t)(rng_next() % (uint64_t)(hi - lo + 1));
+}
+
+// scan_hw.h backend
+
+bool scan_hw_read_hall(void) {
+    bool level = (pieces >> selected_sq) & 1;
+    if (sim_time_us - changed_at_us[selected_sq] < bounce_us) {
+        level = rng_next() & 1;
+    } else if (noise > 0 && rng_unit() < noise) {
+        level = !level;
+    }
+    samples++;
+    return level;
+}
+
+void scan_hw_select(uint8_t from_sq, uint8_t to_sq) {
+    mux_toggles += __builtin_popcount(from_sq ^ to_sq);
+    selected_sq = to_sq;
+}
+
+void scan_hw_set_period_us(uint32_t period_us) {
+    sim_period_us = period_us;
+}
+
+// The simulation loop decides when the consumer runs, see --lag
+void scan_hw_frame_ready(void) {
+}
+
+int64_t scan_hw_time_us(void) {
+    return sim_time_us;
+}
+
+// Busy time is not modelled on the host
+uint32_t scan_hw_cycles(void) {
+    return 0;
+}
+
+uint32_t scan_hw_cycles_per_us(void) {
+    return 1;
+}
+
+static void on_event(const board_event_t *event, void *ctx) {
+    (void)ctx;
+    // A capture lifts and places on the same square, so match by type too.
+    // Anything the script did not cause comes from noise or bounce.
+    int64_t *since = &pending_since[event->type == BOARD_EVENT_PLACE][event->square];
+    int64_t latency = event->timestamp_us - *since;
+    if (*since < 0 || latency < 0) {
+        unmatched_events++;
+        return;
+    }
+    *since = -1;
+    int bucket = (int)(latency / (LATENCY_BUCKET_MS * 1000));
+    latency_hist[bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS]++;
+    latency_count++;
+    latency_sum_us += latency;
+    if (latency > latency_max_us) {
+        latency_max_us = latency;
+    }
+}
+
+static void on_game_event(const board_event_t *event, void *ctx) {
+    (void)ctx;
+    move_t move;
+    infer_status_t status = move_infer_event(&infer, event, &move);
+    if (status == INFER_ILLEGAL) {
+        illegal_reports++;
+    } else if (status == INFER_COMPLETE) {
+        if (recognised >= expected_count || move != expected[recognised]) {
+            wrong_moves++;
+        }
+        recognised++;
+        make_move(&pos, move);
+        move_infer_reset(&infer, &pos, infer.occupied);
+    }
+}
+
+// Same as game.c: matching starts over from the first sweep of each run
+static void on_game_reset(uint64_t occupancy, void *ctx) {
+    (void)ctx;
+    move_infer_reset(&infer, &pos, occupancy);
+}
+
+static void apply_action(const action_t *action) {
+    uint64_t bit = 1ULL << action->square;
+    if (action->type == BOARD_EVENT_LIFT) {
+        pieces &= ~bit;
+    } else {
+        pieces |= bit;
+    }
+    changed_at_us[action->square] = action->time_us;
+    pending_since[action->type == BOARD_EVENT_PLACE][action->square] = action->time_us;
+}
+
+// Runs the scanner until end_us, applying the actions as their time comes
+static void run_until(int64_t end_us, int lag, double speed) {
+    static int next_action;
+    struct timespec wall_start;
+    clock_gettime(CLOCK_MONOTONIC, &wall_start);
+    int64_t sim_start = sim_time_us;
+    int sweeps_waiting = 0;
+
+    while (sim_time_us < end_us) {
+        while (next_action < action_count && actions[next_action].time_us <= sim_time_us) {
+            apply_action(&actions[next_action++]);
+        }
+        scan_core_sample();
+        // one sample per square, so every 64th ends a sweep
+        if ((samples & 63) == 0 && ++sweeps_waiting >= lag) {
+            sweeps_waiting = 0;
+            scan_core_process();
+        }
+        sim_time_us += sim_period_us;
+
+        if (speed > 0 && (samples & 255) == 0) {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            int64_t wall_us = (now.tv_sec - wall_start.tv_sec) * 1000000LL + (now.tv_nsec - wall_start.tv_nsec) / 1000;
+            int64_t ahead_us = (int64_t)((sim_time_us - sim_start) / speed) - wall_us;
+            if (ahead_us > 0) {
+                usleep((useconds_t)ahead_us);
+            }
+        }
+    }
+    if (next_action == action_count) {
+        next_action = 0;
+    }
+}
+
+static void add_action(int64_t time_us, board_event_type_t type, int sq) {
+    if (action_count < MAX_ACTIONS) {
+        actions[action_count++] = (action_t){ time_us, type, (uint8_t)sq };
+    }
+}
+
+static int parse_square(const char *text) {
+    if (text[0] < 'a' || text[0] > 'h' || text[1] < '1' || text[1] > '8') {
+        return -1;
+    }
+    return SQUARE(text[1] - '1', text[0] - 'a');
+}
+
+static bool load_trace(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        perror(path);
+        return false;
+    }
+    char line[128];
+    while (fgets(line, sizeof(line), file)) {
+        char kind[16];
+        char square[8];
+        double ms;
+        long long us;
+        if (sscanf(line, "%lf %15s %7s", &ms, kind, square) == 3) {
+            us = (long long)(ms * 1000);
+        } else if (sscanf(line, "%*[^LP]%15[LIFTPACE] %7s at %lld us", kind, square, &us) != 3) {
+            continue;
+        }
+        int sq = parse_square(square);
+        if (sq < 0) {
+            continue;
+        }
+        bool lift = strcasecmp(kind, "lift") == 0;
+        // Leave time for the scanner to take its first sweep as the baseline
+        add_action(us + 1000000, lift ? BOARD_EVENT_LIFT : BOARD_EVENT_PLACE, sq);
+    }
+    fclose(file);
+    return true;
+}
+
+// Physical steps of a move the way a player makes them
+static int64_t script_move(move_t move, piece_color_t side, int64_t t) {
+    int from = MOVE_FROM(move);
+    int to = MOVE_TO(move);
+    int flags = MOVE_FLAGS(move);
+
+    if (MOVE_IS_CAPTURE(move) && flags != MOVE_EN_PASSANT) {
+        // Some players take the captured piece off first
+        if (rng_next() & 1) {
+            add_action(t, BOARD_EVENT_LIFT, to);
+            add_action(t += rng_range(100000, 400000), BOARD_EVENT_LIFT, from);
+        } else {
+            add_action(t, BOARD_EVENT_LIFT, from);
+            add_action(t += rng_range(100000, 400000), BOARD_EVENT_LIFT, to);
+        }
+        add_action(t += rng_range(100000, 400000), BOARD_EVENT_PLACE, to);
+        return t;
+    }
+
+    add_action(t, BOARD_EVENT_LIFT, from);
+    add_action(t += rng_range(100000, 400000), BOARD_EVENT_PLACE, to);
+    if (flags == MOVE_EN_PASSANT) {
+        add_action(t += rng_range(100000, 400000), BOARD_EVENT_LIFT, (side == WHITE) ? to - 8 : to + 8);
+    } else if (flags == MOVE_CASTLE_KING || flags == MOVE_CASTLE_QUEEN) {
+        int rook_from = (flags == MOVE_CASTLE_KING) ? to + 1 : to - 2;
+        int rook_to = (flags == MOVE_CASTLE_KING) ? to - 1 : to + 1;
+        add_action(t += rng_range(100000, 400000), BOARD_EVENT_LIFT, rook_from);
+        add_action(t += rng_range(100000, 400000), BOARD_EVENT_PLACE, rook_to);
+    }
+    return t;
+}
+
+// Scripts one random legal game, queens only for promotions since that is
+// what the board assumes
+static void script_game(int64_t t) {
+    static position_t game;
+    move_list_t list;
+    position_from_fen(&game, START_FEN);
+    expected_count = 0;
+
+    while (expected_count < MAX_GAME_PLIES && game.halfmove_clock < 100) {
+        generate_legal_moves(&game, &list);
+        int n = 0;
+        for (int i = 0; i < list.count; i++) {
+            if (!MOVE_IS_PROMOTION(list.moves[i]) || MOVE_PROMOTION_PIECE(list.moves[i]) == QUEEN) {
+                list.moves[n++] = list.moves[i];
+            }
+        }
+        if (n == 0) {
+            break;
+        }
+        move_t move = list.moves[rng_next() % n];
+        // Thinking time, then the move
+        t = script_move(move, game.side_to_move, t + rng_range(200000, 1000000));
+        expected[expected_count++] = move;
+        make_move(&game, move);
+    }
+}
+
+static void reset_sim(uint64_t occupancy) {
+    sim_time_us = 0;
+    selected_sq = 0;
+    pieces = occupancy;
+    action_count = 0;
+    for (int sq = 0; sq < 64; sq++) {
+        changed_at_us[sq] = -1000000000;
+        pending_since[0][sq] = -1;
+        pending_since[1][sq] = -1;
+    }
+    sim_period_us = scan_core_init();
+}
+
+static void print_latency(void) {
+    if (latency_count == 0) {
+        printf("no events\n");
+        return;
+    }
+    uint32_t seen = 0;
+    int p50 = -1, p99 = -1;
+    for (int b = 0; b <= LATENCY_BUCKETS; b++) {
+        seen += latency_hist[b];
+        if (p50 < 0 && seen * 2 >= latency_count) p50 = b;
+        if (p99 < 0 && seen * 100 >= latency_count * 99ULL) p99 = b;
+    }
+    printf("Latency: %u events, mean %.1f ms, p50 < %d ms, p99 < %d ms, max %.1f ms, %u unmatched\n",
+           latency_count, latency_sum_us / 1000.0 / latency_count, (p50 + 1) * LATENCY_BUCKET_MS,
+           (p99 + 1) * LATENCY_BUCKET_MS, latency_max_us / 1000.0, unmatched_events);
+}
+
+int main(int argc, char **argv) {
+    const char *trace = NULL;
+    int games = 100;
+    int lag = 1;
+    double speed = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char *value = (i + 1 < argc) ? argv[i + 1] : "0";
+        if (strcmp(argv[i], "--games") == 0) { games = atoi(value); i++; }
+        else if (strcmp(argv[i], "--noise") == 0) { noise = atof(value); i++; }
+        else if (strcmp(argv[i], "--bounce") == 0) { bounce_us = (int64_t)(atof(value) * 1000); i++; }
+        else if (strcmp(argv[i], "--lag") == 0) { lag = atoi(value) > 0 ? atoi(value) : 1; i++; }
+        else if (strcmp(argv[i], "--speed") == 0) { speed = atof(value); i++; }
+        else if (strcmp(argv[i], "--seed") == 0) { rng_state = strtoull(value, NULL, 0) | 1; i++; }
+        else if (argv[i][0] == '-') { fprintf(stderr, "unknown option %s\n", argv[i]); return 2; }
+        else { trace = argv[i]; }
+    }
+
+    position_from_fen(&pos, START_FEN);
+    board_events_subscribe(on_event, NULL);
+
+    struct timespec wall_start, wall_end;
+    clock_gettime(CLOCK_MONOTONIC, &wall_start);
+    int64_t sim_total_us = 0;
+    int total_plies = 0;
+    int games_ok = 0;
+
+    if (trace) {
+        reset_sim(pos.occupied);
+        if (!load_trace(trace)) {
+            return 2;
+        }
+        int64_t end = action_count ? actions[action_count - 1].time_us + 1000000 : 1000000;
+        run_until(end, lag, speed);
+        sim_total_us = sim_time_us;
+        games = 0;
+    } else {
+        board_events_subscribe(on_game_event, NULL);
+        board_events_subscribe_reset(on_game_reset, NULL);
+        for (int g = 0; g < games; g++) {
+            position_from_fen(&pos, START_FEN);
+            reset_sim(pos.occupied);
+            // Started like the firmware's game_new(): from the last known
+            // board, which is empty before the first sweep
+            move_infer_reset(&infer, &pos, board_events_occupancy());
+            recognised = 0;
+            uint32_t wrong_before = wrong_moves;
+
+            script_game(1000000);
+            int64_t end = action_count ? actions[action_count - 1].time_us + 1000000 : 1000000;
+            run_until(end, lag, speed);
+            sim_total_us += sim_time_us;
+            total_plies += expected_count;
+            games_ok += (recognised == expected_count && wrong_moves == wrong_before);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &wall_end);
+    double wall_s = (wall_end.tv_sec - wall_start.tv_sec) + (wall_end.tv_nsec - wall_start.tv_nsec) / 1e9;
+
+    scan_stats_t stats;
+    scan_get_stats(&stats);
+    printf("Simulated %.1f min of play in %.2f s (%.0fx real time), %llu samples, %.2f mux lines per step\n",
+           sim_total_us / 60e6, wall_s, sim_total_us / 1e6 / wall_s, (unsigned long long)samples,
+           samples ? (double)mux_toggles / samples : 0.0);
+    printf("Debounce %d samples, noise %g, bounce %.0f ms, consumer lag %d\n", DEBOUNCE_SAMPLES, noise,
+           bounce_us / 1000.0, lag);
+    print_latency();
+    printf("Last run: %u frames, %u dropped, %u overruns, %u burst entries\n", stats.frames,
+           stats.dropped_frames, stats.ring_overruns, stats.burst_entries);
+    if (games > 0) {
+        printf("Games: %d of %d recognised move for move (%d plies, %.0f games/min), %u wrong moves, %u illegal reports\n",
+               games_ok, games, total_plies, games / wall_s * 60, wrong_moves, illegal_reports);
+        return games_ok == games ? 0 : 1;
+    }
+    return 0;
+}
@@ -0,0 +1,60 @@
+// see_labels.c
+// Prints the safety label of every piece in a position and how long labelling
+// the whole board takes.
+//
+//   see_labels [fen]
+//
+// Each square shows the piece letter followed by . safe, d defended,
+// h hanging or x losing material.
+#include <stdio.h>
+#include <time.h>
+#include "see.h"
+
+#define START_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+#define ROUNDS 200000
+
+static const char piece_letters[2][7] = { "PNBRQK", "pnbrqk" };
+static const char label_marks[] = " .dhx";
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv) {
+    static position_t pos;
+    const char *fen = argc > 1 ? argv[1] : START_FEN;
+    uint8_t labels[64];
+
+    if (!position_from_fen(&pos, fen)) {
+        fprintf(stderr, "invalid FEN\n");
+        return 2;
+    }
+
+    see_label_pieces(&pos, labels);
+    for (int row = 7; row >= 0; row--) {
+        printf("%d ", row + 1);
+        for (int col = 0; col < 8; col++) {
+            int sq = SQUARE(row, col);
+            uint8_t piece = pos.squares[sq];
+            if (PIECE_TYPE(piece) == NO_PIECE) {
+                printf(" - ");
+            } else {
+                printf(" %c%c", piece_letters[PIECE_COLOR(piece)][PIECE_TYPE(piece)], label_marks[labels[sq]]);
+            }
+        }
+        printf("\n");
+    }
+    printf("   a  b  c  d  e  f  g  h\n");
+
+    uint64_t at_risk = 0;
+    double start = now_s();
+    for (int i = 0; i < ROUNDS; i++) {
+        at_risk |= see_label_pieces(&pos, labels);
+    }
+    double elapsed = now_s() - start;
+    printf("%d pieces labelled, %.2f us per board (%llx)\n", bb_popcount(pos.occupied),
+           elapsed * 1e6 / ROUNDS, (unsigned long long)at_risk);
+    return 0;
+}
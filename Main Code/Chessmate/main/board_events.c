@@ -0,0 +1,78 @@
+//Turns consecutive occupancy sweeps into LIFT and PLACE events
+#include "board_events.h"
+#include "latency.h"
+
+typedef struct {
+    board_event_cb_t cb;
+    void *ctx;
+} subscriber_t;
+
+typedef struct {
+    board_reset_cb_t cb;
+    void *ctx;
+} reset_subscriber_t;
+
+static subscriber_t subscribers[BOARD_EVENT_MAX_SUBSCRIBERS];
+static int subscriber_count;
+static reset_subscriber_t reset_subscribers[BOARD_EVENT_MAX_SUBSCRIBERS];
+static int reset_subscriber_count;
+static uint64_t last_occupancy;
+
+bool board_events_subscribe(board_event_cb_t cb, void *ctx) {
+    if (subscriber_count == BOARD_EVENT_MAX_SUBSCRIBERS) {
+        return false;
+    }
+    subscribers[subscriber_count].cb = cb;
+    subscribers[subscriber_count].ctx = ctx;
+    subscriber_count++;
+    return true;
+}
+
+bool board_events_subscribe_reset(board_reset_cb_t cb, void *ctx) {
+    if (reset_subscriber_count == BOARD_EVENT_MAX_SUBSCRIBERS) {
+        return false;
+    }
+    reset_subscribers[reset_subscriber_count].cb = cb;
+    reset_subscribers[reset_subscriber_count].ctx = ctx;
+    reset_subscriber_count++;
+    return true;
+}
+
+void board_events_reset(uint64_t occupancy) {
+    last_occupancy = occupancy;
+    for (int i = 0; i < reset_subscriber_count; i++) {
+        reset_subscribers[i].cb(occupancy, reset_subscribers[i].ctx);
+    }
+}
+
+static void send_events(board_event_type_t type, uint64_t squares, int64_t timestamp_us,
+                        const int64_t *sampled_us) {
+    board_event_t event = { .type = type, .timestamp_us = timestamp_us };
+    while (squares) {
+        event.square = (uint8_t)__builtin_ctzll(squares);
+        squares &= squares - 1;
+        event.sampled_us = sampled_us ? sampled_us[event.square] : timestamp_us;
+        latency_begin(event.sampled_us);
+        for (int i = 0; i < subscriber_count; i++) {
+            subscribers[i].cb(&event, subscribers[i].ctx);
+        }
+    }
+}
+
+int board_events_process(uint64_t occupancy, int64_t timestamp_us, const int64_t sampled_us[64]) {
+    uint64_t changed = occupancy ^ last_occupancy;
+    if (changed == 0) {
+        return 0;
+    }
+
+    // Lifts go out first, so a piece moved within one sweep reads as picked
+    // up and then put down
+    send_events(BOARD_EVENT_LIFT, changed & last_occupancy, timestamp_us, sampled_us);
+    send_events(BOARD_EVENT_PLACE, changed & occupancy, timestamp_us, sampled_us);
+    last_occupancy = occupancy;
+    return __builtin_popcountll(changed);
+}
+
+uint64_t board_events_occupancy(void) {
+    return last_occupancy;
+}
@@ -0,0 +1,51 @@
+// board_events.h
+#ifndef BOARD_EVENTS_H
+#define BOARD_EVENTS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    BOARD_EVENT_LIFT,       // a piece left the square
+    BOARD_EVENT_PLACE       // a piece was put on the square
+} board_event_type_t;
+
+typedef struct {
+    board_event_type_t type;
+    uint8_t square;         // a1 = 0 ... h8 = 63
+    int64_t timestamp_us;   // time of the sweep that completed the debounce
+    int64_t sampled_us;     // time of the first sweep that read the change
+} board_event_t;
+
+// Called once per event, in the order the events happened. Subscribers run on
+// the scan task and should return quickly.
+typedef void (*board_event_cb_t)(const board_event_t *event, void *ctx);
+
+// Called when the occupancy is set without events, e.g. from the first sweep
+// after power up, so subscribers that track the board can start from it
+typedef void (*board_reset_cb_t)(uint64_t occupancy, void *ctx);
+
+#define BOARD_EVENT_MAX_SUBSCRIBERS 4
+
+// Adds a subscriber. Returns false if all slots are taken.
+bool board_events_subscribe(board_event_cb_t cb, void *ctx);
+
+// Adds a reset subscriber. Returns false if all slots are taken.
+bool board_events_subscribe_reset(board_reset_cb_t cb, void *ctx);
+
+// Sets the occupancy later sweeps are compared with, without raising events.
+// Reset subscribers are told the new occupancy.
+void board_events_reset(uint64_t occupancy);
+
+// Compares a sweep with the previous one and sends a LIFT for every square
+// that emptied and a PLACE for every square that filled, lifts first. Returns
+// the number of events sent; an unchanged board costs one comparison.
+// sampled_us holds, per square, when the raw readings started to disagree
+// with the debounced state; it may be NULL, in which case timestamp_us is used.
+// Each event also opens a lift-to-light latency trace (latency.h).
+int board_events_process(uint64_t occupancy, int64_t timestamp_us, const int64_t sampled_us[64]);
+
+// Occupancy after the last processed sweep
+uint64_t board_events_occupancy(void);
+
+#endif // BOARD_EVENTS_H
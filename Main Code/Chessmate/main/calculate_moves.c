@@ -1 +1,773 @@
-//Code to calculate legal moves of a selected piece
\ No newline at end of file
+//Calculates the available moves for each piece on the board
+#include <string.h>
+#include <stdlib.h>
+#include "calculate_moves.h"
+#include "attack_tables.h"
+#include "zobrist_keys.h"
+
+#define FILE_A_BB   ATTACK_A_FILE
+#define FILE_H_BB   (ATTACK_A_FILE << 7)
+#define ROW_4_BB    0x00000000FF000000ULL
+#define ROW_5_BB    0x000000FF00000000ULL
+
+// Check and pin information for the side to move, computed once per position
+// so every piece can be filtered while its moves are generated
+typedef struct {
+    int king;
+    uint64_t checkers;      // enemy pieces giving check
+    uint64_t check_mask;    // squares that capture or block a single check, all squares if none
+    uint64_t pinned;        // own pieces pinned to the king
+    uint64_t king_danger;   // squares attacked by the enemy, seen through our king
+} legal_masks_t;
+
+void position_clear(position_t *pos) {
+    memset(pos, 0, sizeof(*pos));
+    memset(pos->squares, EMPTY_SQUARE, sizeof(pos->squares));
+    pos->side_to_move = WHITE;
+    pos->ep_square = NO_SQUARE;
+    pos->fullmove_number = 1;
+}
+
+void position_set_start(position_t *pos) {
+    static const piece_type_t back_rank[8] = {
+        ROOK, KNIGHT, BISHOP, QUEEN, KING, BISHOP, KNIGHT, ROOK
+    };
+
+    position_clear(pos);
+    for (int col = 0; col < 8; col++) {
+        position_put_piece(pos, WHITE, back_rank[col], SQUARE(0, col));
+        position_put_piece(pos, WHITE, PAWN, SQUARE(1, col));
+        position_put_piece(pos, BLACK, PAWN, SQUARE(6, col));
+        position_put_piece(pos, BLACK, back_rank[col], SQUARE(7, col));
+    }
+    pos->castling = CASTLE_ALL;
+    pos->key = position_compute_key(pos);
+}
+
+// Bitboard and mailbox updates shared by setup, make_move and unmake_move.
+// Keys are handled by the callers.
+static inline void add_piece(position_t *pos, uint8_t piece, int sq) {
+    uint64_t bb = SQUARE_BB(sq);
+    pos->pieces[PIECE_COLOR(piece)][PIECE_TYPE(piece)] |= bb;
+    pos->by_color[PIECE_COLOR(piece)] |= bb;
+    pos->occupied |= bb;
+    pos->squares[sq] = piece;
+}
+
+static inline void clear_piece(position_t *pos, uint8_t piece, int sq) {
+    uint64_t bb = SQUARE_BB(sq);
+    pos->pieces[PIECE_COLOR(piece)][PIECE_TYPE(piece)] &= ~bb;
+    pos->by_color[PIECE_COLOR(piece)] &= ~bb;
+    pos->occupied &= ~bb;
+    pos->squares[sq] = EMPTY_SQUARE;
+}
+
+static inline void move_piece(position_t *pos, uint8_t piece, int from, int to) {
+    uint64_t bb = SQUARE_BB(from) | SQUARE_BB(to);
+    pos->pieces[PIECE_COLOR(piece)][PIECE_TYPE(piece)] ^= bb;
+    pos->by_color[PIECE_COLOR(piece)] ^= bb;
+    pos->occupied ^= bb;
+    pos->squares[from] = EMPTY_SQUARE;
+    pos->squares[to] = piece;
+}
+
+static inline uint64_t piece_key(uint8_t piece, int sq) {
+    return ZOBRIST_PIECES[PIECE_COLOR(piece)][PIECE_TYPE(piece)][sq];
+}
+
+// Squares attacked by the piece on sq with the given occupancy
+static uint64_t piece_attacks(uint8_t piece, int sq, uint64_t occupied) {
+    switch (PIECE_TYPE(piece)) {
+        case PAWN:   return pawn_attacks(PIECE_COLOR(piece), sq);
+        case KNIGHT: return knight_attacks(sq);
+        case BISHOP: return bishop_attacks(sq, occupied);
+        case ROOK:   return rook_attacks(sq, occupied);
+        case QUEEN:  return queen_attacks(sq, occupied);
+        case KING:   return king_attacks(sq);
+        default:     return 0;
+    }
+}
+
+// Adds one to the count of every square in bb, rippling the carry up the planes
+static inline void count_add(uint64_t *planes, uint64_t bb) {
+    for (int i = 0; i < ATTACK_COUNT_BITS && bb; i++) {
+        uint64_t carry = planes[i] & bb;
+        planes[i] ^= bb;
+        bb = carry;
+    }
+}
+
+static inline void count_sub(uint64_t *planes, uint64_t bb) {
+    for (int i = 0; i < ATTACK_COUNT_BITS && bb; i++) {
+        uint64_t borrow = ~planes[i] & bb;
+        planes[i] ^= bb;
+        bb = borrow;
+    }
+}
+
+// Attack counts are updated around every board change in two halves. Only the
+// pieces on the changed squares and the sliders whose rays reach one of them
+// can attack different squares afterwards, and a slider that reaches a
+// changed square afterwards already reached one before. begin takes those
+// pieces' attacks out of the counts and returns the sliders that stay put;
+// end puts the attacks back in with the new occupancy.
+static uint64_t begin_attack_update(position_t *pos, uint64_t changed) {
+    uint64_t diagonal = pos->pieces[WHITE][BISHOP] | pos->pieces[BLACK][BISHOP]
+                      | pos->pieces[WHITE][QUEEN] | pos->pieces[BLACK][QUEEN];
+    uint64_t straight = pos->pieces[WHITE][ROOK] | pos->pieces[BLACK][ROOK]
+                      | pos->pieces[WHITE][QUEEN] | pos->pieces[BLACK][QUEEN];
+    uint64_t sliders = 0;
+    uint64_t bb = changed;
+    while (bb) {
+        int sq = bb_pop_lsb(&bb);
+        sliders |= (bishop_attacks(sq, pos->occupied) & diagonal) | (rook_attacks(sq, pos->occupied) & straight);
+    }
+    sliders &= ~changed;
+
+    bb = sliders | (pos->occupied & changed);
+    while (bb) {
+        int sq = bb_pop_lsb(&bb);
+        uint8_t piece = pos->squares[sq];
+        count_sub(pos->attack_counts[PIECE_COLOR(piece)], piece_attacks(piece, sq, pos->occupied));
+    }
+    return sliders;
+}
+
+static void end_attack_update(position_t *pos, uint64_t changed, uint64_t sliders) {
+    uint64_t bb = sliders | (pos->occupied & changed);
+    while (bb) {
+        int sq = bb_pop_lsb(&bb);
+        uint8_t piece = pos->squares[sq];
+        count_add(pos->attack_counts[PIECE_COLOR(piece)], piece_attacks(piece, sq, pos->occupied));
+    }
+}
+
+void position_put_piece(position_t *pos, piece_color_t color, piece_type_t type, int sq) {
+    uint64_t sliders = pos->track_attacks ? begin_attack_update(pos, SQUARE_BB(sq)) : 0;
+    uint8_t old = pos->squares[sq];
+    if (old != EMPTY_SQUARE) {
+        clear_piece(pos, old, sq);
+        pos->key ^= piece_key(old, sq);
+    }
+    add_piece(pos, MAKE_PIECE(color, type), sq);
+    pos->key ^= ZOBRIST_PIECES[color][type][sq];
+    if (pos->track_attacks) {
+        end_attack_update(pos, SQUARE_BB(sq), sliders);
+    }
+}
+
+void position_remove_piece(position_t *pos, int sq) {
+    uint8_t piece = pos->squares[sq];
+    if (piece == EMPTY_SQUARE) {
+        return;
+    }
+    uint64_t sliders = pos->track_attacks ? begin_attack_update(pos, SQUARE_BB(sq)) : 0;
+    clear_piece(pos, piece, sq);
+    pos->key ^= piece_key(piece, sq);
+    if (pos->track_attacks) {
+        end_attack_update(pos, SQUARE_BB(sq), sliders);
+    }
+}
+
+void position_compute_attacks(const position_t *pos, uint64_t counts[2][ATTACK_COUNT_BITS]) {
+    memset(counts, 0, sizeof(uint64_t) * 2 * ATTACK_COUNT_BITS);
+    uint64_t bb = pos->occupied;
+    while (bb) {
+        int sq = bb_pop_lsb(&bb);
+        uint8_t piece = pos->squares[sq];
+        count_add(counts[PIECE_COLOR(piece)], piece_attacks(piece, sq, pos->occupied));
+    }
+}
+
+void position_track_attacks(position_t *pos, bool on) {
+    pos->track_attacks = on;
+    if (on) {
+        position_compute_attacks(pos, pos->attack_counts);
+    }
+}
+
+int attack_count(const position_t *pos, piece_color_t color, int sq) {
+    int count = 0;
+    for (int i = 0; i < ATTACK_COUNT_BITS; i++) {
+        count |= (int)((pos->attack_counts[color][i] >> sq) & 1) << i;
+    }
+    return count;
+}
+
+uint64_t position_compute_key(const position_t *pos) {
+    uint64_t key = ZOBRIST_CASTLING[pos->castling];
+    for (int sq = 0; sq < 64; sq++) {
+        if (pos->squares[sq] != EMPTY_SQUARE) {
+            key ^= piece_key(pos->squares[sq], sq);
+        }
+    }
+    if (pos->ep_square != NO_SQUARE) {
+        key ^= ZOBRIST_EN_PASSANT[SQUARE_COL(pos->ep_square)];
+    }
+    if (pos->side_to_move == BLACK) {
+        key ^= ZOBRIST_SIDE;
+    }
+    return key;
+}
+
+// An en passant square only counts if a pawn can actually take there, so
+// positions that differ by an unusable en passant square share a key
+static int8_t usable_ep_square(const position_t *pos, int sq, piece_color_t capturer) {
+    if (pawn_attacks(!capturer, sq) & pos->pieces[capturer][PAWN]) {
+        return (int8_t)sq;
+    }
+    return NO_SQUARE;
+}
+
+bool position_from_fen(position_t *pos, const char *fen) {
+    static const char piece_chars[] = "pnbrqk";
+    int row = 7;
+    int col = 0;
+
+    position_clear(pos);
+    for (; *fen && *fen != ' '; fen++) {
+        char c = *fen;
+        if (c == '/') {
+            row--;
+            col = 0;
+        } else if (c >= '1' && c <= '8') {
+            col += c - '0';
+        } else {
+            const char *type = strchr(piece_chars, (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c);
+            if (type == NULL || row < 0 || col > 7) {
+                return false;
+            }
+            position_put_piece(pos, (c >= 'A' && c <= 'Z') ? WHITE : BLACK,
+                               (piece_type_t)(type - piece_chars), SQUARE(row, col));
+            col++;
+        }
+    }
+    if (row != 0 || bb_popcount(pos->pieces[WHITE][KING]) != 1 || bb_popcount(pos->pieces[BLACK][KING]) != 1) {
+        return false;
+    }
+
+    while (*fen == ' ') fen++;
+    if (*fen != 'w' && *fen != 'b') {
+        return false;
+    }
+    pos->side_to_move = (*fen++ == 'w') ? WHITE : BLACK;
+
+    while (*fen == ' ') fen++;
+    for (; *fen && *fen != ' '; fen++) {
+        switch (*fen) {
+            case 'K': pos->castling |= CASTLE_WHITE_KING; break;
+            case 'Q': pos->castling |= CASTLE_WHITE_QUEEN; break;
+            case 'k': pos->castling |= CASTLE_BLACK_KING; break;
+            case 'q': pos->castling |= CASTLE_BLACK_QUEEN; break;
+            case '-': break;
+            default: return false;
+        }
+    }
+
+    while (*fen == ' ') fen++;
+    if (fen[0] >= 'a' && fen[0] <= 'h' && fen[1] >= '1' && fen[1] <= '8') {
+        pos->ep_square = usable_ep_square(pos, SQUARE(fen[1] - '1', fen[0] - 'a'), pos->side_to_move);
+        fen += 2;
+    } else if (*fen == '-') {
+        fen++;
+    }
+
+    // The move counters are optional
+    char *end;
+    long halfmove = strtol(fen, &end, 10);
+    if (end != fen) {
+        pos->halfmove_clock = (uint16_t)halfmove;
+        long fullmove = strtol(end, &end, 10);
+        if (fullmove > 0) {
+            pos->fullmove_number = (uint16_t)fullmove;
+        }
+    }
+    pos->key = position_compute_key(pos);
+    return true;
+}
+
+// Castling rights lost when a move starts or ends on sq
+static uint8_t castling_lost(int sq) {
+    switch (sq) {
+        case SQUARE(0, 0): return CASTLE_WHITE_QUEEN;
+        case SQUARE(0, 4): return CASTLE_WHITE_KING | CASTLE_WHITE_QUEEN;
+        case SQUARE(0, 7): return CASTLE_WHITE_KING;
+        case SQUARE(7, 0): return CASTLE_BLACK_QUEEN;
+        case SQUARE(7, 4): return CASTLE_BLACK_KING | CASTLE_BLACK_QUEEN;
+        case SQUARE(7, 7): return CASTLE_BLACK_KING;
+        default: return 0;
+    }
+}
+
+// Squares whose contents a move changes
+static uint64_t move_changed_squares(move_t move, piece_color_t us) {
+    int to = MOVE_TO(move);
+    uint64_t changed = SQUARE_BB(MOVE_FROM(move)) | SQUARE_BB(to);
+    switch (MOVE_FLAGS(move)) {
+        case MOVE_EN_PASSANT:   return changed | SQUARE_BB((us == WHITE) ? to - 8 : to + 8);
+        case MOVE_CASTLE_KING:  return changed | SQUARE_BB(to + 1) | SQUARE_BB(to - 1);
+        case MOVE_CASTLE_QUEEN: return changed | SQUARE_BB(to - 2) | SQUARE_BB(to + 1);
+        default:                return changed;
+    }
+}
+
+void make_move(position_t *pos, move_t move) {
+    piece_color_t us = pos->side_to_move;
+    int from = MOVE_FROM(move);
+    int to = MOVE_TO(move);
+    int flags = MOVE_FLAGS(move);
+    uint8_t piece = pos->squares[from];
+    uint64_t key = pos->key ^ ZOBRIST_SIDE ^ ZOBRIST_CASTLING[pos->castling];
+
+    undo_t *undo = &pos->history[pos->ply++ & (POSITION_HISTORY - 1)];
+    undo->key = pos->key;
+    undo->move = move;
+    undo->captured = EMPTY_SQUARE;
+    undo->castling = pos->castling;
+    undo->ep_square = pos->ep_square;
+    undo->halfmove_clock = pos->halfmove_clock;
+
+    bool track = pos->track_attacks;
+    uint64_t changed = track ? move_changed_squares(move, us) : 0;
+    uint64_t sliders = track ? begin_attack_update(pos, changed) : 0;
+
+    if (pos->ep_square != NO_SQUARE) {
+        key ^= ZOBRIST_EN_PASSANT[SQUARE_COL(pos->ep_square)];
+        pos->ep_square = NO_SQUARE;
+    }
+
+    pos->halfmove_clock++;
+    if (PIECE_TYPE(piece) == PAWN || MOVE_IS_CAPTURE(move)) {
+        pos->halfmove_clock = 0;
+    }
+
+    if (MOVE_IS_CAPTURE(move)) {
+        int captured_sq = (flags == MOVE_EN_PASSANT) ? ((us == WHITE) ? to - 8 : to + 8) : to;
+        undo->captured = pos->squares[captured_sq];
+        clear_piece(pos, undo->captured, captured_sq);
+        key ^= piece_key(undo->captured, captured_sq);
+    }
+
+    if (MOVE_IS_PROMOTION(move)) {
+        uint8_t promoted = MAKE_PIECE(us, MOVE_PROMOTION_PIECE(move));
+        clear_piece(pos, piece, from);
+        add_piece(pos, promoted, to);
+        key ^= piece_key(piece, from) ^ piece_key(promoted, to);
+    } else {
+        move_piece(pos, piece, from, to);
+        key ^= piece_key(piece, from) ^ piece_key(piece, to);
+    }
+
+    if (flags == MOVE_CASTLE_KING || flags == MOVE_CASTLE_QUEEN) {
+        int rook_from = (flags == MOVE_CASTLE_KING) ? to + 1 : to - 2;
+        int rook_to = (flags == MOVE_CASTLE_KING) ? to - 1 : to + 1;
+        uint8_t rook = MAKE_PIECE(us, ROOK);
+        move_piece(pos, rook, rook_from, rook_to);
+        key ^= piece_key(rook, rook_from) ^ piece_key(rook, rook_to);
+    } else if (flags == MOVE_DOUBLE_PUSH) {
+        pos->ep_square = usable_ep_square(pos, (from + to) / 2, !us);
+        if (pos->ep_square != NO_SQUARE) {
+            key ^= ZOBRIST_EN_PASSANT[SQUARE_COL(pos->ep_square)];
+        }
+    }
+
+    if (track) {
+        end_attack_update(pos, changed, sliders);
+    }
+    pos->castling &= ~(castling_lost(from) | castling_lost(to));
+    pos->key = key ^ ZOBRIST_CASTLING[pos->castling];
+    if (us == BLACK) {
+        pos->fullmove_number++;
+    }
+    pos->side_to_move = !us;
+}
+
+void unmake_move(position_t *pos) {
+    const undo_t *undo = &pos->history[--pos->ply & (POSITION_HISTORY - 1)];
+    move_t move = undo->move;
+    piece_color_t us = !pos->side_to_move;
+    int from = MOVE_FROM(move);
+    int to = MOVE_TO(move);
+    int flags = MOVE_FLAGS(move);
+    bool track = pos->track_attacks;
+    uint64_t changed = track ? move_changed_squares(move, us) : 0;
+    uint64_t sliders = track ? begin_attack_update(pos, changed) : 0;
+
+    if (MOVE_IS_PROMOTION(move)) {
+        clear_piece(pos, pos->squares[to], to);
+        add_piece(pos, MAKE_PIECE(us, PAWN), from);
+    } else {
+        move_piece(pos, pos->squares[to], to, from);
+    }
+
+    if (flags == MOVE_CASTLE_KING) {
+        move_piece(pos, MAKE_PIECE(us, ROOK), to - 1, to + 1);
+    } else if (flags == MOVE_CASTLE_QUEEN) {
+        move_piece(pos, MAKE_PIECE(us, ROOK), to + 1, to - 2);
+    } else if (undo->captured != EMPTY_SQUARE) {
+        int captured_sq = (flags == MOVE_EN_PASSANT) ? ((us == WHITE) ? to - 8 : to + 8) : to;
+        add_piece(pos, undo->captured, captured_sq);
+    }
+    if (track) {
+        end_attack_update(pos, changed, sliders);
+    }
+
+    if (us == BLACK) {
+        pos->fullmove_number--;
+    }
+    pos->side_to_move = us;
+    pos->castling = undo->castling;
+    pos->ep_square = undo->ep_square;
+    pos->halfmove_clock = undo->halfmove_clock;
+    pos->key = undo->key;
+}
+
+bool position_is_repetition(const position_t *pos) {
+    int limit = pos->halfmove_clock;
+    if (limit > pos->ply) {
+        limit = pos->ply;
+    }
+    if (limit > POSITION_HISTORY) {
+        limit = POSITION_HISTORY;
+    }
+    // Only positions with the same side to move can repeat, so step by two plies
+    for (int back = 4; back <= limit; back += 2) {
+        if (pos->history[(pos->ply - back) & (POSITION_HISTORY - 1)].key == pos->key) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void move_to_string(move_t move, char *out) {
+    static const char promotion_chars[] = "nbrq";
+    out[0] = 'a' + SQUARE_COL(MOVE_FROM(move));
+    out[1] = '1' + SQUARE_ROW(MOVE_FROM(move));
+    out[2] = 'a' + SQUARE_COL(MOVE_TO(move));
+    out[3] = '1' + SQUARE_ROW(MOVE_TO(move));
+    out[4] = MOVE_IS_PROMOTION(move) ? promotion_chars[MOVE_FLAGS(move) & 3] : '\0';
+    out[5] = '\0';
+}
+
+uint64_t king_attacks(int sq) {
+    return KING_ATTACKS[sq];
+}
+
+uint64_t knight_attacks(int sq) {
+    return KNIGHT_ATTACKS[sq];
+}
+
+uint64_t pawn_attacks(piece_color_t color, int sq) {
+    return PAWN_ATTACKS[color][sq];
+}
+
+// Gathers the inner occupancy of a rank or diagonal into a 6 bit index and
+// looks up the attacks along that line (see tools/gen_attack_tables.py)
+static inline uint64_t line_attacks(uint64_t line, int sq, uint64_t occupied) {
+    uint32_t index = (uint32_t)(((line & occupied) * ATTACK_B_FILE) >> 58);
+    return line & FILL_UP_ATTACKS[SQUARE_COL(sq)][index];
+}
+
+static inline uint64_t file_attacks(int sq, uint64_t occupied) {
+    uint64_t file = ATTACK_A_FILE & (occupied >> SQUARE_COL(sq));
+    uint32_t index = (uint32_t)((file * ATTACK_DIAG_C7_B2) >> 58);
+    return A_FILE_ATTACKS[SQUARE_ROW(sq)][index] << SQUARE_COL(sq);
+}
+
+uint64_t bishop_attacks(int sq, uint64_t occupied) {
+    return line_attacks(DIAG_MASK[sq], sq, occupied) | line_attacks(ANTI_DIAG_MASK[sq], sq, occupied);
+}
+
+uint64_t rook_attacks(int sq, uint64_t occupied) {
+    return line_attacks(RANK_MASK[sq], sq, occupied) | file_attacks(sq, occupied);
+}
+
+uint64_t queen_attacks(int sq, uint64_t occupied) {
+    return bishop_attacks(sq, occupied) | rook_attacks(sq, occupied);
+}
+
+static uint64_t pawn_targets(const position_t *pos, piece_color_t color, int sq) {
+    uint64_t bb = SQUARE_BB(sq);
+    uint64_t push = (color == WHITE) ? (bb << 8) : (bb >> 8);
+    return (push & ~pos->occupied) | (pawn_attacks(color, sq) & pos->by_color[!color]);
+}
+
+uint64_t piece_targets(const position_t *pos, int sq) {
+    uint8_t piece = pos->squares[sq];
+    if (piece == EMPTY_SQUARE) {
+        return 0;
+    }
+
+    piece_color_t color = PIECE_COLOR(piece);
+    uint64_t targets;
+    switch (PIECE_TYPE(piece)) {
+        case PAWN:   targets = pawn_targets(pos, color, sq); break;
+        case KNIGHT: targets = knight_attacks(sq); break;
+        case BISHOP: targets = bishop_attacks(sq, pos->occupied); break;
+        case ROOK:   targets = rook_attacks(sq, pos->occupied); break;
+        case QUEEN:  targets = queen_attacks(sq, pos->occupied); break;
+        case KING:   targets = king_attacks(sq); break;
+        default:     targets = 0; break;
+    }
+    return targets & ~pos->by_color[color];
+}
+
+uint64_t attackers_to(const position_t *pos, int sq, uint64_t occupied) {
+    uint64_t bishops = pos->pieces[WHITE][BISHOP] | pos->pieces[BLACK][BISHOP] |
+                       pos->pieces[WHITE][QUEEN] | pos->pieces[BLACK][QUEEN];
+    uint64_t rooks = pos->pieces[WHITE][ROOK] | pos->pieces[BLACK][ROOK] |
+                     pos->pieces[WHITE][QUEEN] | pos->pieces[BLACK][QUEEN];
+
+    return (pawn_attacks(BLACK, sq) & pos->pieces[WHITE][PAWN]) |
+           (pawn_attacks(WHITE, sq) & pos->pieces[BLACK][PAWN]) |
+           (knight_attacks(sq) & (pos->pieces[WHITE][KNIGHT] | pos->pieces[BLACK][KNIGHT])) |
+           (king_attacks(sq) & (pos->pieces[WHITE][KING] | pos->pieces[BLACK][KING])) |
+           (bishop_attacks(sq, occupied) & bishops) |
+           (rook_attacks(sq, occupied) & rooks);
+}
+
+bool in_check(const position_t *pos) {
+    piece_color_t us = pos->side_to_move;
+    int king = bb_lsb(pos->pieces[us][KING]);
+    return (attackers_to(pos, king, pos->occupied) & pos->by_color[!us]) != 0;
+}
+
+// Every square attacked by one side with the given occupancy
+static uint64_t attacks_by(const position_t *pos, piece_color_t color, uint64_t occupied) {
+    uint64_t pawns = pos->pieces[color][PAWN];
+    uint64_t attacks;
+    if (color == WHITE) {
+        attacks = ((pawns << 7) & ~FILE_H_BB) | ((pawns << 9) & ~FILE_A_BB);
+    } else {
+        attacks = ((pawns >> 9) & ~FILE_H_BB) | ((pawns >> 7) & ~FILE_A_BB);
+    }
+
+    uint64_t bb = pos->pieces[color][KNIGHT];
+    while (bb) {
+        attacks |= knight_attacks(bb_pop_lsb(&bb));
+    }
+    bb = pos->pieces[color][BISHOP] | pos->pieces[color][QUEEN];
+    while (bb) {
+        attacks |= bishop_attacks(bb_pop_lsb(&bb), occupied);
+    }
+    bb = pos->pieces[color][ROOK] | pos->pieces[color][QUEEN];
+    while (bb) {
+        attacks |= rook_attacks(bb_pop_lsb(&bb), occupied);
+    }
+    return attacks | king_attacks(bb_lsb(pos->pieces[color][KING]));
+}
+
+// Squares strictly between a and b if they share a rank, file or diagonal
+static uint64_t between(int a, int b) {
+    uint64_t a_bb = SQUARE_BB(a);
+    uint64_t b_bb = SQUARE_BB(b);
+    if (rook_attacks(a, 0) & b_bb) {
+        return rook_attacks(a, b_bb) & rook_attacks(b, a_bb);
+    }
+    if (bishop_attacks(a, 0) & b_bb) {
+        return bishop_attacks(a, b_bb) & bishop_attacks(b, a_bb);
+    }
+    return 0;
+}
+
+// The whole rank, file or diagonal through a and b (a pinned piece stays on it)
+static uint64_t line_through(int a, int b) {
+    uint64_t b_bb = SQUARE_BB(b);
+    uint64_t file = FILE_A_BB << SQUARE_COL(a);
+    if (RANK_MASK[a] & b_bb) {
+        return RANK_MASK[a] | SQUARE_BB(a);
+    }
+    if (file & b_bb) {
+        return file;
+    }
+    if (DIAG_MASK[a] & b_bb) {
+        return DIAG_MASK[a] | SQUARE_BB(a);
+    }
+    if (ANTI_DIAG_MASK[a] & b_bb) {
+        return ANTI_DIAG_MASK[a] | SQUARE_BB(a);
+    }
+    return 0;
+}
+
+static void compute_legal_masks(const position_t *pos, legal_masks_t *masks) {
+    piece_color_t us = pos->side_to_move;
+    piece_color_t them = !us;
+    uint64_t theirs = pos->by_color[them];
+    int king = bb_lsb(pos->pieces[us][KING]);
+
+    masks->king = king;
+    masks->checkers = attackers_to(pos, king, pos->occupied) & theirs;
+    masks->king_danger = attacks_by(pos, them, pos->occupied ^ SQUARE_BB(king));
+
+    if (masks->checkers == 0) {
+        masks->check_mask = ~0ULL;
+    } else if (bb_popcount(masks->checkers) == 1) {
+        masks->check_mask = masks->checkers | between(king, bb_lsb(masks->checkers));
+    } else {
+        masks->check_mask = 0;  // double check, only the king can move
+    }
+
+    // Enemy sliders that would see the king if exactly one of our pieces moved
+    uint64_t snipers =
+        (rook_attacks(king, theirs) & (pos->pieces[them][ROOK] | pos->pieces[them][QUEEN])) |
+        (bishop_attacks(king, theirs) & (pos->pieces[them][BISHOP] | pos->pieces[them][QUEEN]));
+    masks->pinned = 0;
+    while (snipers) {
+        uint64_t blockers = between(king, bb_pop_lsb(&snipers)) & pos->occupied;
+        if (bb_popcount(blockers) == 1 && (blockers & pos->by_color[us])) {
+            masks->pinned |= blockers;
+        }
+    }
+}
+
+static uint64_t castling_targets(const position_t *pos, const legal_masks_t *masks) {
+    piece_color_t us = pos->side_to_move;
+    int base = (us == WHITE) ? 0 : 56;
+    uint8_t king_side = (us == WHITE) ? CASTLE_WHITE_KING : CASTLE_BLACK_KING;
+    uint8_t queen_side = (us == WHITE) ? CASTLE_WHITE_QUEEN : CASTLE_BLACK_QUEEN;
+    uint64_t rooks = pos->pieces[us][ROOK];
+    uint64_t targets = 0;
+
+    if (masks->checkers || masks->king != base + 4) {
+        return 0;
+    }
+    if ((pos->castling & king_side) && (rooks & SQUARE_BB(base + 7))) {
+        uint64_t path = SQUARE_BB(base + 5) | SQUARE_BB(base + 6);
+        if (!(pos->occupied & path) && !(masks->king_danger & path)) {
+            targets |= SQUARE_BB(base + 6);
+        }
+    }
+    if ((pos->castling & queen_side) && (rooks & SQUARE_BB(base))) {
+        uint64_t empty = SQUARE_BB(base + 1) | SQUARE_BB(base + 2) | SQUARE_BB(base + 3);
+        uint64_t path = SQUARE_BB(base + 2) | SQUARE_BB(base + 3);
+        if (!(pos->occupied & empty) && !(masks->king_danger & path)) {
+            targets |= SQUARE_BB(base + 2);
+        }
+    }
+    return targets;
+}
+
+// En passant can uncover a check along the rank that both pawns leave, which
+// no pin test catches, so the king is re-checked with the final occupancy
+static bool en_passant_legal(const position_t *pos, const legal_masks_t *masks, int from) {
+    piece_color_t us = pos->side_to_move;
+    piece_color_t them = !us;
+    int to = pos->ep_square;
+    int captured = (us == WHITE) ? to - 8 : to + 8;
+
+    if (masks->checkers & ~SQUARE_BB(captured) &
+        (pos->pieces[them][PAWN] | pos->pieces[them][KNIGHT])) {
+        return false;
+    }
+    uint64_t occupied = (pos->occupied ^ SQUARE_BB(from) ^ SQUARE_BB(captured)) | SQUARE_BB(to);
+    uint64_t bishops = pos->pieces[them][BISHOP] | pos->pieces[them][QUEEN];
+    uint64_t rooks = pos->pieces[them][ROOK] | pos->pieces[them][QUEEN];
+    return !(bishop_attacks(masks->king, occupied) & bishops) &&
+           !(rook_attacks(masks->king, occupied) & rooks);
+}
+
+static uint64_t legal_piece_targets(const position_t *pos, const legal_masks_t *masks, int sq) {
+    piece_color_t us = pos->side_to_move;
+    uint64_t ours = pos->by_color[us];
+    uint64_t theirs = pos->by_color[!us];
+    uint64_t targets;
+
+    switch (PIECE_TYPE(pos->squares[sq])) {
+        case PAWN: {
+            uint64_t bb = SQUARE_BB(sq);
+            uint64_t empty = ~pos->occupied;
+            uint64_t single, twice;
+            if (us == WHITE) {
+                single = (bb << 8) & empty;
+                twice = (single << 8) & empty & ROW_4_BB;
+            } else {
+                single = (bb >> 8) & empty;
+                twice = (single >> 8) & empty & ROW_5_BB;
+            }
+            targets = (single | twice | (pawn_attacks(us, sq) & theirs)) & masks->check_mask;
+            if (pos->ep_square != NO_SQUARE && (pawn_attacks(us, sq) & SQUARE_BB(pos->ep_square)) &&
+                en_passant_legal(pos, masks, sq)) {
+                targets |= SQUARE_BB(pos->ep_square);
+            }
+            break;
+        }
+        case KNIGHT: targets = knight_attacks(sq) & ~ours & masks->check_mask; break;
+        case BISHOP: targets = bishop_attacks(sq, pos->occupied) & ~ours & masks->check_mask; break;
+        case ROOK:   targets = rook_attacks(sq, pos->occupied) & ~ours & masks->check_mask; break;
+        case QUEEN:  targets = queen_attacks(sq, pos->occupied) & ~ours & masks->check_mask; break;
+        case KING:
+            return (king_attacks(sq) & ~ours & ~masks->king_danger) | castling_targets(pos, masks);
+        default:
+            return 0;
+    }
+
+    if (masks->pinned & SQUARE_BB(sq)) {
+        targets &= line_through(masks->king, sq);
+    }
+    return targets;
+}
+
+static void add_moves(const position_t *pos, int from, uint64_t targets, move_list_t *list) {
+    piece_type_t type = PIECE_TYPE(pos->squares[from]);
+
+    while (targets) {
+        int to = bb_pop_lsb(&targets);
+        int flags = (pos->squares[to] != EMPTY_SQUARE) ? MOVE_CAPTURE : MOVE_QUIET;
+
+        if (type == PAWN) {
+            if (to == pos->ep_square) {
+                flags = MOVE_EN_PASSANT;
+            } else if (to - from == 16 || from - to == 16) {
+                flags = MOVE_DOUBLE_PUSH;
+            } else if (SQUARE_ROW(to) == 0 || SQUARE_ROW(to) == 7) {
+                for (int promo = 3; promo >= 0; promo--) {
+                    list->moves[list->count++] = MAKE_MOVE(from, to, flags | MOVE_PROMOTION | promo);
+                }
+                continue;
+            }
+        } else if (type == KING && (to - from == 2 || from - to == 2)) {
+            flags = (to > from) ? MOVE_CASTLE_KING : MOVE_CASTLE_QUEEN;
+        }
+        list->moves[list->count++] = MAKE_MOVE(from, to, flags);
+    }
+}
+
+int generate_legal_moves(const position_t *pos, move_list_t *list) {
+    legal_masks_t masks;
+    compute_legal_masks(pos, &masks);
+
+    list->count = 0;
+    uint64_t pieces = pos->by_color[pos->side_to_move];
+    if (masks.check_mask == 0) {
+        pieces = SQUARE_BB(masks.king);
+    }
+    while (pieces) {
+        int sq = bb_pop_lsb(&pieces);
+        add_moves(pos, sq, legal_piece_targets(pos, &masks, sq), list);
+    }
+    return list->count;
+}
+
+uint64_t legal_targets(const position_t *pos, int sq) {
+    uint8_t piece = pos->squares[sq];
+    if (piece == EMPTY_SQUARE || PIECE_COLOR(piece) != pos->side_to_move) {
+        return 0;
+    }
+
+    legal_masks_t masks;
+    compute_legal_masks(pos, &masks);
+    return legal_piece_targets(pos, &masks, sq);
+}
+
+uint64_t generate_legal_targets(const position_t *pos, uint64_t targets[64]) {
+    legal_masks_t masks;
+    compute_legal_masks(pos, &masks);
+
+    uint64_t written = pos->by_color[pos->side_to_move];
+    uint64_t pieces = written;
+    while (pieces) {
+        int sq = bb_pop_lsb(&pieces);
+        targets[sq] = legal_piece_targets(pos, &masks, sq);
+    }
+    return written;
+}
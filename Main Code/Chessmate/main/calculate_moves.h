@@ -0,0 +1,196 @@
+// calculate_moves.h
+#ifndef CALCULATE_MOVES_H
+#define CALCULATE_MOVES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Squares are numbered a1 = 0 ... h8 = 63. A square's row and column match the
+// Board[row][col] layout used by available_moves.py.
+#define SQUARE(row, col)  ((row) * 8 + (col))
+#define SQUARE_ROW(sq)    ((sq) >> 3)
+#define SQUARE_COL(sq)    ((sq) & 7)
+#define SQUARE_BB(sq)     (1ULL << (sq))
+#define NO_SQUARE         (-1)
+
+typedef enum {
+    WHITE,
+    BLACK
+} piece_color_t;
+
+typedef enum {
+    PAWN,
+    KNIGHT,
+    BISHOP,
+    ROOK,
+    QUEEN,
+    KING,
+    NO_PIECE
+} piece_type_t;
+
+// Mailbox encoding of a piece: color in bit 3, type in bits 0-2
+#define MAKE_PIECE(color, type) ((uint8_t)(((color) << 3) | (type)))
+#define PIECE_COLOR(piece)      ((piece_color_t)((piece) >> 3))
+#define PIECE_TYPE(piece)       ((piece_type_t)((piece) & 7))
+#define EMPTY_SQUARE            MAKE_PIECE(WHITE, NO_PIECE)
+
+// Castling rights
+#define CASTLE_WHITE_KING   0x01
+#define CASTLE_WHITE_QUEEN  0x02
+#define CASTLE_BLACK_KING   0x04
+#define CASTLE_BLACK_QUEEN  0x08
+#define CASTLE_ALL          0x0F
+
+// Moves are packed as from (bits 0-5), to (bits 6-11) and flags (bits 12-15)
+typedef uint16_t move_t;
+
+// State make_move() saves so unmake_move() can restore it without a copy
+typedef struct {
+    uint64_t key;
+    move_t move;
+    uint8_t captured;           // piece taken by the move, or EMPTY_SQUARE
+    uint8_t castling;
+    int8_t ep_square;
+    uint16_t halfmove_clock;
+} undo_t;
+
+// Attacker counts per square are stored as bit planes: bit i of every
+// square's count lives in plane i, so a piece's whole attack set is added or
+// removed with a few bitboard operations. One side has at most 16 pieces.
+#define ATTACK_COUNT_BITS 5
+
+// Plies kept in the undo ring. Must be a power of two and at least 100 so
+// repetitions can be found back to the last capture or pawn move.
+#define POSITION_HISTORY 256
+
+// Board position stored as one bitboard per color and piece type
+typedef struct {
+    uint64_t pieces[2][6];      // pieces[color][type]
+    uint64_t by_color[2];       // all pieces of one color
+    uint64_t occupied;          // all pieces on the board
+    uint8_t squares[64];        // piece on each square, for lookups by square
+    piece_color_t side_to_move;
+    uint8_t castling;           // CASTLE_* flags still available
+    int8_t ep_square;           // square a pawn can capture en passant, or NO_SQUARE
+    uint16_t halfmove_clock;    // plies since the last capture or pawn move
+    uint16_t fullmove_number;
+    uint64_t key;               // Zobrist key, kept up to date by every change
+    uint64_t attack_counts[2][ATTACK_COUNT_BITS];   // attackers per square by color, as count planes
+    bool track_attacks;         // attack_counts are only kept up to date while set
+    uint16_t ply;               // plies made since the position was set up
+    undo_t history[POSITION_HISTORY];
+} position_t;
+
+#define MOVE_QUIET              0x0
+#define MOVE_DOUBLE_PUSH        0x1
+#define MOVE_CASTLE_KING        0x2
+#define MOVE_CASTLE_QUEEN       0x3
+#define MOVE_CAPTURE            0x4
+#define MOVE_EN_PASSANT         0x5
+#define MOVE_PROMOTION          0x8     // low two bits select knight, bishop, rook or queen
+
+#define MAKE_MOVE(from, to, flags)  ((move_t)((from) | ((to) << 6) | ((flags) << 12)))
+#define MOVE_FROM(move)             ((move) & 63)
+#define MOVE_TO(move)               (((move) >> 6) & 63)
+#define MOVE_FLAGS(move)            ((move) >> 12)
+#define MOVE_IS_CAPTURE(move)       ((MOVE_FLAGS(move) & MOVE_CAPTURE) != 0)
+#define MOVE_IS_PROMOTION(move)     ((MOVE_FLAGS(move) & MOVE_PROMOTION) != 0)
+#define MOVE_PROMOTION_PIECE(move)  ((piece_type_t)(KNIGHT + (MOVE_FLAGS(move) & 3)))
+
+// No legal chess position has more than 218 moves
+#define MAX_MOVES 256
+
+typedef struct {
+    move_t moves[MAX_MOVES];
+    int count;
+} move_list_t;
+
+// Bitboard helpers
+static inline int bb_popcount(uint64_t bb) { return __builtin_popcountll(bb); }
+static inline int bb_lsb(uint64_t bb) { return __builtin_ctzll(bb); }
+static inline int bb_pop_lsb(uint64_t *bb) {
+    int sq = __builtin_ctzll(*bb);
+    *bb &= *bb - 1;
+    return sq;
+}
+
+void position_clear(position_t *pos);
+void position_set_start(position_t *pos);
+void position_put_piece(position_t *pos, piece_color_t color, piece_type_t type, int sq);
+void position_remove_piece(position_t *pos, int sq);
+
+// Loads a position in Forsyth-Edwards Notation. Returns false on malformed input.
+bool position_from_fen(position_t *pos, const char *fen);
+
+// Plays a legal move in place, saving what is needed to take it back.
+// unmake_move() takes back the most recent move; up to POSITION_HISTORY moves
+// can be taken back in a row.
+void make_move(position_t *pos, move_t move);
+void unmake_move(position_t *pos);
+
+// Zobrist key computed from scratch, for setup and for checking the
+// incremental updates
+uint64_t position_compute_key(const position_t *pos);
+
+// Attack count planes computed from scratch, for checking the incremental
+// updates done by make_move() and unmake_move()
+void position_compute_attacks(const position_t *pos, uint64_t counts[2][ATTACK_COUNT_BITS]);
+
+// Turns the incremental attack counts on or off. They cost every make_move()
+// and unmake_move() a few times the move itself, so only the live game keeps
+// them; search and perft positions leave them off. Turning them on fills the
+// counts from scratch. Setting up a position turns them off.
+void position_track_attacks(position_t *pos, bool on);
+
+// Squares attacked by color, read from the incrementally kept counts without
+// generating any moves. Only valid with position_track_attacks() on.
+static inline uint64_t attacked_squares(const position_t *pos, piece_color_t color) {
+    const uint64_t *planes = pos->attack_counts[color];
+    return planes[0] | planes[1] | planes[2] | planes[3] | planes[4];
+}
+
+// Number of pieces of color attacking sq, with position_track_attacks() on
+int attack_count(const position_t *pos, piece_color_t color, int sq);
+
+// True if the position occurred before with the same side to move since the
+// last capture or pawn move
+bool position_is_repetition(const position_t *pos);
+
+// Writes a move in coordinate notation such as "e2e4" or "e7e8q" (6 bytes)
+void move_to_string(move_t move, char *out);
+
+// Squares attacked by a piece standing on sq. Sliding pieces stop at the
+// first occupied square in each direction (that square is included).
+// All lookups use the const tables generated into attack_tables.h.
+uint64_t king_attacks(int sq);
+uint64_t knight_attacks(int sq);
+uint64_t pawn_attacks(piece_color_t color, int sq);
+uint64_t bishop_attacks(int sq, uint64_t occupied);
+uint64_t rook_attacks(int sq, uint64_t occupied);
+uint64_t queen_attacks(int sq, uint64_t occupied);
+
+// Destination mask for the piece on sq, or 0 if the square is empty.
+// Squares held by the piece's own side are never included. Checks, pins and
+// special moves are ignored; use legal_targets() during a game.
+uint64_t piece_targets(const position_t *pos, int sq);
+
+// Pieces of either color attacking sq, given the occupancy in occupied
+uint64_t attackers_to(const position_t *pos, int sq, uint64_t occupied);
+bool in_check(const position_t *pos);
+
+// Legal moves for the side to move. Checks, pins, king safety, double pawn
+// pushes, en passant, castling and promotion are all resolved while the moves
+// are generated, so no move has to be tried and taken back. Both functions
+// require a king of each color on the board.
+int generate_legal_moves(const position_t *pos, move_list_t *list);
+
+// Legal destination mask for the piece on sq, or 0 if it is empty or does not
+// belong to the side to move. A castling king lists its destination square.
+uint64_t legal_targets(const position_t *pos, int sq);
+
+// Legal destination masks for every piece of the side to move in one pass.
+// Only the entries for those pieces are written; the return value has a bit
+// set for each of them.
+uint64_t generate_legal_targets(const position_t *pos, uint64_t targets[64]);
+
+#endif // CALCULATE_MOVES_H
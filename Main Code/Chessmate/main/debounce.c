@@ -0,0 +1,33 @@
+//Debounces the hall sensors of all 64 squares at once
+#include <string.h>
+#include "debounce.h"
+
+void debounce_init(debounce_t *db, uint64_t occupancy) {
+    memset(db, 0, sizeof(*db));
+    db->stable = occupancy;
+}
+
+uint64_t debounce_update(debounce_t *db, uint64_t raw) {
+    uint64_t differ = raw ^ db->stable;
+
+    // Count up where the reading disagrees, and clear the counters where it
+    // agrees so only unbroken runs reach the threshold
+    uint64_t carry = differ;
+    for (int i = 0; i < DEBOUNCE_BITS; i++) {
+        uint64_t next = db->count[i] & carry;
+        db->count[i] = (db->count[i] ^ carry) & differ;
+        carry = next;
+    }
+
+    // Squares whose count equals DEBOUNCE_SAMPLES, compared plane by plane
+    uint64_t reached = differ;
+    for (int i = 0; i < DEBOUNCE_BITS; i++) {
+        reached &= ((DEBOUNCE_SAMPLES >> i) & 1) ? db->count[i] : ~db->count[i];
+    }
+
+    db->stable ^= reached;
+    for (int i = 0; i < DEBOUNCE_BITS; i++) {
+        db->count[i] &= ~reached;
+    }
+    return db->stable;
+}
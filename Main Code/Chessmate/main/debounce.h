@@ -0,0 +1,44 @@
+// debounce.h
+#ifndef DEBOUNCE_H
+#define DEBOUNCE_H
+
+#include <stdint.h>
+
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#endif
+
+// Consecutive sweeps a square must read the same before it changes state.
+// Set per board build in menuconfig, or with -DDEBOUNCE_SAMPLES=<n> on the host.
+#ifndef DEBOUNCE_SAMPLES
+#ifdef CONFIG_CHESSMATE_DEBOUNCE_SAMPLES
+#define DEBOUNCE_SAMPLES CONFIG_CHESSMATE_DEBOUNCE_SAMPLES
+#else
+#define DEBOUNCE_SAMPLES 3
+#endif
+#endif
+
+// Bit planes in each square's counter; 4 planes count up to 15 samples
+#define DEBOUNCE_BITS 4
+
+// The count has to reach DEBOUNCE_SAMPLES without wrapping the counter
+_Static_assert(DEBOUNCE_SAMPLES >= 1 && DEBOUNCE_SAMPLES < (1 << DEBOUNCE_BITS),
+               "DEBOUNCE_SAMPLES must fit the DEBOUNCE_BITS counter (1 to 15)");
+
+// Vertical counters for all 64 squares: bit i of a square's count of
+// disagreeing samples lives in count[i], so every square is filtered by the
+// same few word operations
+typedef struct {
+    uint64_t stable;                    // debounced occupancy
+    uint64_t count[DEBOUNCE_BITS];
+} debounce_t;
+
+// Starts with occupancy as the stable state and all counters at zero
+void debounce_init(debounce_t *db, uint64_t occupancy);
+
+// Feeds one raw sweep and returns the debounced occupancy. A square flips
+// after DEBOUNCE_SAMPLES raw readings in a row that disagree with its stable
+// state; a single agreeing reading starts its count over.
+uint64_t debounce_update(debounce_t *db, uint64_t raw);
+
+#endif // DEBOUNCE_H
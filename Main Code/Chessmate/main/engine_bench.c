@@ -0,0 +1,68 @@
+//Times the engine's per-move bookkeeping on the board and on the host
+#include <string.h>
+#include "engine_bench.h"
+#include "calculate_moves.h"
+#include "time_us.h"
+
+// Opening, busy middlegame with castling and en passant, promotions, quiet middlegame
+static const char *const bench_fens[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+};
+
+static bool maps_match(const position_t *pos) {
+    uint64_t counts[2][ATTACK_COUNT_BITS];
+    position_compute_attacks(pos, counts);
+    return memcmp(counts, pos->attack_counts, sizeof(counts)) == 0;
+}
+
+void engine_bench_attack_maps(int rounds, attack_bench_t *result) {
+    static position_t pos;
+    static move_list_t list;
+    uint64_t counts[2][ATTACK_COUNT_BITS];
+
+    memset(result, 0, sizeof(*result));
+    for (size_t f = 0; f < sizeof(bench_fens) / sizeof(bench_fens[0]); f++) {
+        position_from_fen(&pos, bench_fens[f]);
+        position_track_attacks(&pos, true);
+        generate_legal_moves(&pos, &list);
+
+        // Check every move once outside the timed loops
+        for (int i = 0; i < list.count; i++) {
+            make_move(&pos, list.moves[i]);
+            result->mismatches += !maps_match(&pos);
+            unmake_move(&pos);
+            result->mismatches += !maps_match(&pos);
+        }
+
+        int64_t start = time_now_us();
+        for (int r = 0; r < rounds; r++) {
+            for (int i = 0; i < list.count; i++) {
+                make_move(&pos, list.moves[i]);
+                unmake_move(&pos);
+            }
+        }
+        result->make_unmake_us += time_now_us() - start;
+
+        position_track_attacks(&pos, false);
+        start = time_now_us();
+        for (int r = 0; r < rounds; r++) {
+            for (int i = 0; i < list.count; i++) {
+                make_move(&pos, list.moves[i]);
+                unmake_move(&pos);
+            }
+        }
+        result->plain_us += time_now_us() - start;
+
+        start = time_now_us();
+        for (int r = 0; r < rounds; r++) {
+            for (int i = 0; i < list.count; i++) {
+                position_compute_attacks(&pos, counts);
+            }
+        }
+        result->recompute_us += time_now_us() - start;
+        result->moves += (uint32_t)(rounds * list.count);
+    }
+}
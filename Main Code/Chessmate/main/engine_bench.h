@@ -0,0 +1,20 @@
+// engine_bench.h
+#ifndef ENGINE_BENCH_H
+#define ENGINE_BENCH_H
+
+#include <stdint.h>
+
+// Cost of keeping the attack maps up to date, measured the same way on the
+// board and in the host build
+typedef struct {
+    uint32_t moves;             // make/unmake pairs timed
+    int64_t make_unmake_us;     // total for those pairs, incremental updates included
+    int64_t plain_us;           // the same pairs with the attack maps off, as search and perft run
+    int64_t recompute_us;       // total for rebuilding both maps from scratch once per move
+    uint32_t mismatches;        // positions where the incremental maps were wrong
+} attack_bench_t;
+
+// Plays every legal move of a few reference positions rounds times
+void engine_bench_attack_maps(int rounds, attack_bench_t *result);
+
+#endif // ENGINE_BENCH_H
@@ -0,0 +1,270 @@
+//Owns the live game: the position, its cached legal targets and the hint search
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "game.h"
+#include "move_cache.h"
+#include "search.h"
+#include "see.h"
+#include "board_events.h"
+#include "latency.h"
+#include "led_display.h"
+
+// The hint search runs below the scan, button and display tasks so it can
+// never hold them up, on the second core where there is one
+#define HINT_TASK_PRIORITY  1
+#define HINT_TASK_STACK     4096
+#define HINT_TASK_CORE      ((portNUM_PROCESSORS > 1) ? 1 : 0)
+
+static const char *TAG = "game";
+
+// The live game is changed on the scan task and read from the button and
+// hint tasks, so everything from live_position to assist_level is only
+// touched with game_lock held. Callbacks run after it is released.
+static SemaphoreHandle_t game_lock;
+#define GAME_LOCK()     xSemaphoreTake(game_lock, portMAX_DELAY)
+#define GAME_UNLOCK()   xSemaphoreGive(game_lock)
+
+static position_t live_position;
+static move_cache_t live_cache;
+static uint8_t live_labels[64];
+static uint64_t live_at_risk;
+static move_infer_t live_infer;
+static infer_status_t infer_status = INFER_IDLE;
+static game_move_cb_t move_callback;
+static uint64_t lifted_targets;         // legal targets of the piece in the player's hand
+static assist_level_t assist_level = ASSIST_LOW;
+
+// The search makes and unmakes moves on its own copy of the position
+static position_t hint_position;
+static int64_t hint_budget_us;
+static bool hint_pending;               // a request is waiting for hint_task
+static volatile uint32_t hint_request_id;
+static game_hint_cb_t hint_callback;
+static TaskHandle_t hint_task_handle;
+
+static void hint_task(void *pvParameter) {
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // The stop flag is cleared and the snapshot taken under game_lock, so
+        // a move committed after this point stops the search it starts
+        GAME_LOCK();
+        search_arm();
+        bool pending = hint_pending;
+        hint_pending = false;
+        uint32_t request_id = hint_request_id;
+        int64_t budget_us = hint_budget_us;
+        if (pending) {
+            hint_position = live_position;
+            position_track_attacks(&hint_position, false);
+        }
+        GAME_UNLOCK();
+        if (!pending) {
+            continue;
+        }
+
+        search_result_t result;
+        search_hint(&hint_position, budget_us, &result);
+        ESP_LOGI(TAG, "Hint depth %d, %lu nodes in %lld ms%s", result.depth, (unsigned long)result.nodes,
+                 result.elapsed_us / 1000, result.stopped ? " (stopped)" : "");
+
+        // Drop the result if the game moved on while searching
+        GAME_LOCK();
+        bool current = request_id == hint_request_id && result.best_move != 0;
+        if (current) {
+            led_post(LED_LAYER_HINT, SQUARE_BB(MOVE_FROM(result.best_move)) | SQUARE_BB(MOVE_TO(result.best_move)));
+        }
+        GAME_UNLOCK();
+        if (current && hint_callback) {
+            hint_callback(result.best_move);
+        }
+    }
+}
+
+// Stops a running search and makes sure its result is dropped. Called with
+// game_lock held.
+static void cancel_hint(void) {
+    hint_request_id++;
+    hint_pending = false;
+    search_stop();
+}
+
+// Hanging pieces are a teaching overlay, shown with assist High only
+static void post_threatened(void) {
+    led_post(LED_LAYER_THREATENED, (assist_level == ASSIST_HIGH) ? live_at_risk : 0);
+}
+
+// game_commit_move() with game_lock held
+static void commit_move(move_t move) {
+    cancel_hint();
+    make_move(&live_position, move);
+    move_cache_update(&live_cache, &live_position);
+    live_at_risk = see_label_pieces(&live_position, live_labels);
+    move_infer_reset(&live_infer, &live_position, live_infer.occupied);
+
+    piece_color_t side = live_position.side_to_move;
+    led_post(LED_LAYER_LAST_MOVE, SQUARE_BB(MOVE_FROM(move)) | SQUARE_BB(MOVE_TO(move)));
+    led_post(LED_LAYER_CHECK, in_check(&live_position) ? live_position.pieces[side][KING] : 0);
+    led_post(LED_LAYER_HINT, 0);
+    post_threatened();
+}
+
+// Runs on the scan task for every LIFT and PLACE
+static void on_board_event(const board_event_t *event, void *ctx) {
+    move_t move = 0;
+    GAME_LOCK();
+    infer_status_t status = move_infer_event(&live_infer, event, &move);
+
+    if (status == INFER_COMPLETE) {
+        commit_move(move);
+    }
+    // The first thing the player waits for is the lifted piece's moves. A
+    // captured piece has none, so it does not replace the capturer's.
+    if (status == INFER_PENDING) {
+        uint64_t targets = (event->type == BOARD_EVENT_LIFT) ?
+                           move_cache_targets(&live_cache, &live_position, event->square) : 0;
+        if (targets) {
+            lifted_targets = targets;
+        }
+    } else {
+        lifted_targets = 0;
+    }
+    latency_stamp(LATENCY_MOVEGEN);
+    led_post(LED_LAYER_TARGETS, lifted_targets);
+    led_post(LED_LAYER_ILLEGAL, (status == INFER_ILLEGAL) ? live_infer.occupied ^ live_infer.base : 0);
+    led_post_event_done();
+
+    // An illegal board is reported once, when it turns illegal
+    bool report = status == INFER_COMPLETE || status == INFER_PUT_BACK ||
+                  (status == INFER_ILLEGAL && infer_status != INFER_ILLEGAL);
+    infer_status = (status == INFER_COMPLETE) ? INFER_IDLE : status;
+    GAME_UNLOCK();
+
+    if (report && move_callback) {
+        move_callback(status, (status == INFER_COMPLETE) ? move : 0);
+    }
+}
+
+// The first sweep after power up shows what is really on the board; matching
+// starts over from it so pieces already set up are not read as lifted
+static void on_board_reset(uint64_t occupancy, void *ctx) {
+    GAME_LOCK();
+    move_infer_reset(&live_infer, &live_position, occupancy);
+    infer_status = INFER_IDLE;
+    lifted_targets = 0;
+    led_post(LED_LAYER_TARGETS, 0);
+    led_post(LED_LAYER_ILLEGAL, 0);
+    GAME_UNLOCK();
+}
+
+void game_init(game_hint_cb_t hint_cb) {
+    hint_callback = hint_cb;
+    game_lock = xSemaphoreCreateMutex();
+    move_cache_init(&live_cache);
+    game_new();
+    board_events_subscribe(on_board_event, NULL);
+    board_events_subscribe_reset(on_board_reset, NULL);
+
+    xTaskCreatePinnedToCore(hint_task, "hint_task", HINT_TASK_STACK, NULL, HINT_TASK_PRIORITY,
+                            &hint_task_handle, HINT_TASK_CORE);
+}
+
+void game_new(void) {
+    GAME_LOCK();
+    cancel_hint();
+    position_set_start(&live_position);
+    // Only the live game pays for attack maps, which see_label_pieces() reads
+    // for the threatened overlay
+    position_track_attacks(&live_position, true);
+    move_cache_invalidate(&live_cache);
+    move_cache_update(&live_cache, &live_position);
+    live_at_risk = see_label_pieces(&live_position, live_labels);
+    // The pieces may not be set up yet; moves are recognised once they are.
+    // Before the first sweep this is empty and on_board_reset() catches up.
+    move_infer_reset(&live_infer, &live_position, board_events_occupancy());
+    infer_status = INFER_IDLE;
+    lifted_targets = 0;
+    for (int layer = 0; layer < LED_LAYER_COUNT; layer++) {
+        led_post(layer, 0);
+    }
+    post_threatened();
+    GAME_UNLOCK();
+}
+
+void game_set_move_callback(game_move_cb_t move_cb) {
+    move_callback = move_cb;
+}
+
+const position_t *game_get_position(void) {
+    return &live_position;
+}
+
+void game_commit_move(move_t move) {
+    GAME_LOCK();
+    commit_move(move);
+    GAME_UNLOCK();
+}
+
+uint64_t game_lift_targets(int sq) {
+    GAME_LOCK();
+    uint64_t targets = move_cache_targets(&live_cache, &live_position, sq);
+    GAME_UNLOCK();
+    return targets;
+}
+
+uint64_t game_lifted_targets(void) {
+    GAME_LOCK();
+    uint64_t targets = lifted_targets;
+    GAME_UNLOCK();
+    return targets;
+}
+
+const uint8_t *game_piece_labels(void) {
+    return live_labels;
+}
+
+uint64_t game_pieces_at_risk(void) {
+    GAME_LOCK();
+    uint64_t at_risk = live_at_risk;
+    GAME_UNLOCK();
+    return at_risk;
+}
+
+void game_set_assist_level(assist_level_t level) {
+    GAME_LOCK();
+    assist_level = level;
+    if (level != ASSIST_HIGH) {
+        cancel_hint();
+        led_post(LED_LAYER_HINT, 0);
+    }
+    post_threatened();
+    GAME_UNLOCK();
+}
+
+void game_get_cache_stats(uint32_t *hits, uint32_t *rebuilds) {
+    GAME_LOCK();
+    *hits = live_cache.hits;
+    *rebuilds = live_cache.rebuilds;
+    GAME_UNLOCK();
+}
+
+assist_level_t game_get_assist_level(void) {
+    return assist_level;
+}
+
+void game_request_hint(int remaining_s) {
+    if (assist_level != ASSIST_HIGH || hint_task_handle == NULL) {
+        return;
+    }
+
+    // Only the request is posted here: this runs on the scan task, which must
+    // not wait for a search. hint_task takes the latest position when it wakes.
+    GAME_LOCK();
+    cancel_hint();
+    hint_budget_us = search_budget_us(remaining_s);
+    hint_pending = true;
+    GAME_UNLOCK();
+    xTaskNotifyGive(hint_task_handle);
+}
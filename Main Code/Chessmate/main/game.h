@@ -0,0 +1,63 @@
+// game.h
+#ifndef GAME_H
+#define GAME_H
+
+#include <stdint.h>
+#include "calculate_moves.h"
+#include "move_infer.h"
+
+typedef enum {
+    ASSIST_LOW,     // show legal moves for a lifted piece
+    ASSIST_HIGH     // also search for a best-move hint after every move
+} assist_level_t;
+
+// Called from the hint task when the hint for the current position is ready
+typedef void (*game_hint_cb_t)(move_t hint);
+
+// Called on the scan task when pieces moved on the board: with INFER_COMPLETE
+// after the move has been committed, and when the board turns illegal or
+// everything is put back
+typedef void (*game_move_cb_t)(infer_status_t status, move_t move);
+
+// Sets up the start position and the low priority hint task, and subscribes
+// to board events so moves played on the board are committed as they finish
+void game_init(game_hint_cb_t hint_cb);
+void game_set_move_callback(game_move_cb_t move_cb);
+void game_new(void);
+
+// The live position itself, not a copy. Only read it from a board event
+// subscriber or the move callback, which run on the scan task that changes it.
+const position_t *game_get_position(void);
+
+// Plays a move on the live position, refreshes the legal target cache,
+// relabels every piece and starts matching board events against the new
+// position. Moves finished on the board are committed automatically.
+void game_commit_move(move_t move);
+
+// Legal targets of a lifted piece, read from the cache
+uint64_t game_lift_targets(int sq);
+
+// Targets of the piece last lifted on the board while a move is in progress,
+// 0 once the move completes, is put back or turns illegal
+uint64_t game_lifted_targets(void);
+
+// see_label_t of every square after the last committed move, and the mask of
+// pieces labelled hanging or losing, for beginner warnings. The labels are
+// the live array, with the same rule as game_get_position().
+const uint8_t *game_piece_labels(void);
+uint64_t game_pieces_at_risk(void);
+
+// Lookups the legal target cache answered without regenerating, and times it
+// was rebuilt, for the stats log
+void game_get_cache_stats(uint32_t *hits, uint32_t *rebuilds);
+
+void game_set_assist_level(assist_level_t level);
+assist_level_t game_get_assist_level(void);
+
+// With assist High, searches for a hint for the side to move in the
+// background. remaining_s is that player's clock (player1_time or
+// player2_time) and sets the deadline. A newer request or a committed move
+// cancels a search that is still running.
+void game_request_hint(int remaining_s);
+
+#endif // GAME_H
@@ -0,0 +1,119 @@
+//Lift-to-light latency: stage timestamps per board event, aggregated into histograms
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include "latency.h"
+#include "time_us.h"
+
+// Stamps come from the scan task and the LED refresh, so the trace and the
+// histograms are only touched inside a short critical section
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+static portMUX_TYPE latency_lock = portMUX_INITIALIZER_UNLOCKED;
+#define LATENCY_LOCK()      taskENTER_CRITICAL(&latency_lock)
+#define LATENCY_UNLOCK()    taskEXIT_CRITICAL(&latency_lock)
+#else
+#define LATENCY_LOCK()
+#define LATENCY_UNLOCK()
+#endif
+
+static const uint32_t bucket_edges_us[LATENCY_BUCKETS - 1] = LATENCY_BUCKET_EDGES_US;
+
+static const char *const stage_names[LATENCY_STAGES] = { "sample", "event", "movegen", "led" };
+
+static int64_t trace[LATENCY_STAGES];       // stamps of the open trace, 0 where not stamped yet
+static latency_hist_t step_hist[LATENCY_STAGES];
+static latency_hist_t total_hist[LATENCY_STAGES];
+
+static void hist_add(latency_hist_t *hist, int64_t elapsed_us) {
+    if (elapsed_us < 0) {
+        return;
+    }
+    int bucket = 0;
+    while (bucket < LATENCY_BUCKETS - 1 && elapsed_us >= bucket_edges_us[bucket]) {
+        bucket++;
+    }
+    hist->buckets[bucket]++;
+    hist->count++;
+    hist->total_us += (uint64_t)elapsed_us;
+    if (elapsed_us > hist->max_us) {
+        hist->max_us = (uint32_t)elapsed_us;
+    }
+}
+
+// Called with the lock held
+static void stamp_at(latency_stage_t stage, int64_t now_us) {
+    if (trace[LATENCY_SAMPLE] == 0 || trace[stage] != 0) {
+        return;
+    }
+    trace[stage] = now_us;
+    int prev = stage - 1;
+    while (trace[prev] == 0) {
+        prev--;
+    }
+    hist_add(&step_hist[stage], now_us - trace[prev]);
+    hist_add(&total_hist[stage], now_us - trace[LATENCY_SAMPLE]);
+}
+
+void latency_begin(int64_t sampled_us) {
+    int64_t now_us = time_now_us();
+    LATENCY_LOCK();
+    memset(trace, 0, sizeof(trace));
+    // 0 marks an unstamped stage, and the clock starts at 0
+    trace[LATENCY_SAMPLE] = sampled_us ? sampled_us : 1;
+    stamp_at(LATENCY_EVENT, now_us);
+    LATENCY_UNLOCK();
+}
+
+void latency_stamp(latency_stage_t stage) {
+    int64_t now_us = time_now_us();
+    LATENCY_LOCK();
+    stamp_at(stage, now_us);
+    LATENCY_UNLOCK();
+}
+
+void latency_get(latency_stage_t stage, latency_hist_t *step, latency_hist_t *total) {
+    LATENCY_LOCK();
+    if (step) {
+        *step = step_hist[stage];
+    }
+    if (total) {
+        *total = total_hist[stage];
+    }
+    LATENCY_UNLOCK();
+}
+
+void latency_reset(void) {
+    LATENCY_LOCK();
+    memset(trace, 0, sizeof(trace));
+    memset(step_hist, 0, sizeof(step_hist));
+    memset(total_hist, 0, sizeof(total_hist));
+    LATENCY_UNLOCK();
+}
+
+static int format_hist(char *buf, size_t size, const char *name, const latency_hist_t *hist, bool buckets) {
+    double mean_ms = hist->count ? hist->total_us / 1000.0 / hist->count : 0;
+    int len = snprintf(buf, size, "%-14s n=%-5lu avg %6.1f ms max %6.1f ms", name, (unsigned long)hist->count,
+                       mean_ms, hist->max_us / 1000.0);
+    for (int b = 0; buckets && b < LATENCY_BUCKETS; b++) {
+        len += snprintf(buf + len, len < (int)size ? size - len : 0, " %lu", (unsigned long)hist->buckets[b]);
+    }
+    len += snprintf(buf + len, len < (int)size ? size - len : 0, "\n");
+    return len;
+}
+
+int latency_format(char *buf, size_t size) {
+    latency_hist_t step[LATENCY_STAGES];
+    latency_hist_t total[LATENCY_STAGES];
+    for (int stage = LATENCY_EVENT; stage < LATENCY_STAGES; stage++) {
+        latency_get(stage, &step[stage], &total[stage]);
+    }
+
+    int len = snprintf(buf, size, "Time since the previous stage, buckets <0.5 <1 <2 <5 <10 <20 <50 <100 <200 <500 ms and slower\n");
+    for (int stage = LATENCY_EVENT; stage < LATENCY_STAGES; stage++) {
+        len += format_hist(buf + len, len < (int)size ? size - len : 0, stage_names[stage], &step[stage], true);
+    }
+    len += format_hist(buf + len, len < (int)size ? size - len : 0, "sample>led", &total[LATENCY_LED], false);
+    return len;
+}
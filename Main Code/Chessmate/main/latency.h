@@ -0,0 +1,50 @@
+// latency.h
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Stages between a piece changing on the board and the player seeing the
+// result. Every board event opens a trace; each later stage is stamped the
+// first time it happens after that, so a trace measures one lift or place.
+typedef enum {
+    LATENCY_SAMPLE,     // first sweep that read the change, before debouncing
+    LATENCY_EVENT,      // debounced LIFT/PLACE handed to the subscribers
+    LATENCY_MOVEGEN,    // legal moves and move inference done for the event
+    LATENCY_LED,        // LED frame showing the result committed
+    LATENCY_STAGES
+} latency_stage_t;
+
+// Upper bucket edges in microseconds; the last bucket takes everything slower
+#define LATENCY_BUCKET_EDGES_US { 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000 }
+#define LATENCY_BUCKETS 11
+
+typedef struct {
+    uint32_t buckets[LATENCY_BUCKETS];
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t total_us;
+} latency_hist_t;
+
+// Opens a new trace for a board event, stamping LATENCY_SAMPLE at sampled_us
+// and LATENCY_EVENT now. A trace still open from the previous event is dropped.
+void latency_begin(int64_t sampled_us);
+
+// Stamps a stage of the open trace with the current time. Stages already
+// stamped, or stamped before anything opened a trace, are ignored, so
+// callers on every path can stamp unconditionally.
+void latency_stamp(latency_stage_t stage);
+
+// Time from the previous stamped stage of the same trace to stage, and from
+// LATENCY_SAMPLE to stage. Nothing is recorded for LATENCY_SAMPLE itself.
+void latency_get(latency_stage_t stage, latency_hist_t *step, latency_hist_t *total);
+
+void latency_reset(void);
+
+// One line per stage: count, mean, max and the bucket counts of the step
+// histogram, then the sample to LED total. Meant for the
+// serial console; returns the length written, like snprintf.
+int latency_format(char *buf, size_t size);
+
+#endif // LATENCY_H
@@ -0,0 +1,46 @@
+//Resolves bitboard overlay layers into an LED frame by priority
+#include "led_compose.h"
+
+const led_layer_style_t led_layer_styles[LED_LAYER_COUNT] = {
+    [LED_LAYER_LAST_MOVE]  = { LED_RGB(0, 0, 255),    1, LED_ANIM_FADE },
+    [LED_LAYER_THREATENED] = { LED_RGB(255, 160, 0),  2, LED_ANIM_STEADY },
+    [LED_LAYER_HINT]       = { LED_RGB(160, 0, 255),  3, LED_ANIM_STEADY },
+    [LED_LAYER_TARGETS]    = { LED_RGB(0, 255, 0),    4, LED_ANIM_STEADY },
+    [LED_LAYER_CHECK]      = { LED_RGB(255, 0, 0),    5, LED_ANIM_PULSE },
+    [LED_LAYER_ILLEGAL]    = { LED_RGB(255, 96, 0),   6, LED_ANIM_FLASH },
+};
+
+// Layers from the highest priority down
+static uint8_t layer_order[LED_LAYER_COUNT];
+
+void led_compose_init(void) {
+    for (int i = 0; i < LED_LAYER_COUNT; i++) {
+        int j = i;
+        while (j > 0 && led_layer_styles[layer_order[j - 1]].priority < led_layer_styles[i].priority) {
+            layer_order[j] = layer_order[j - 1];
+            j--;
+        }
+        layer_order[j] = (uint8_t)i;
+    }
+}
+
+void led_compose(const uint64_t layers[LED_LAYER_COUNT], const led_color_t colors[LED_LAYER_COUNT],
+                 led_color_t frame[LED_COUNT]) {
+    uint64_t covered = 0;
+    for (int i = 0; i < LED_LAYER_COUNT; i++) {
+        int layer = layer_order[i];
+        uint64_t squares = layers[layer] & ~covered;
+        covered |= squares;
+        led_color_t color = colors[layer];
+        while (squares) {
+            frame[__builtin_ctzll(squares)] = color;
+            squares &= squares - 1;
+        }
+    }
+
+    uint64_t dark = ~covered;
+    while (dark) {
+        frame[__builtin_ctzll(dark)] = LED_OFF;
+        dark &= dark - 1;
+    }
+}
@@ -0,0 +1,35 @@
+// led_compose.h
+#ifndef LED_COMPOSE_H
+#define LED_COMPOSE_H
+
+#include <stdint.h>
+#include "led_display.h"
+
+// How a layer's brightness moves over time, from the moment its squares change
+typedef enum {
+    LED_ANIM_STEADY,
+    LED_ANIM_FADE,          // full, fading out to nothing
+    LED_ANIM_PULSE,         // breathing between a floor and full
+    LED_ANIM_FLASH          // hard on/off
+} led_anim_t;
+
+typedef struct {
+    led_color_t color;
+    uint8_t priority;       // where layers overlap the highest priority wins
+    led_anim_t anim;
+} led_layer_style_t;
+
+// One row per led_layer_t. A new overlay is a new layer and a row here.
+extern const led_layer_style_t led_layer_styles[LED_LAYER_COUNT];
+
+// Sorts the layers by priority once, for led_compose()
+void led_compose_init(void);
+
+// Resolves the layers into a frame in one pass over them, highest priority
+// first: each layer claims only the squares no higher layer took, so every
+// lit square is written once and the rest are cleared with the leftover
+// mask. colors holds each layer's colour for this frame, animation applied.
+void led_compose(const uint64_t layers[LED_LAYER_COUNT], const led_color_t colors[LED_LAYER_COUNT],
+                 led_color_t frame[LED_COUNT]);
+
+#endif // LED_COMPOSE_H
@@ -1 +1,372 @@
-//Led writing functions
\ No newline at end of file
+//Double-buffered framebuffer for the square LEDs, sending only what changed
+#include <string.h>
+#include <math.h>
+#include "led_display.h"
+#include "led_compose.h"
+#include "led_hw.h"
+#include "latency.h"
+#include "time_us.h"
+
+// Drawing and the buffer swap can run on different tasks; the lock is only
+// held for the pixel copies, never while a frame is on the wire
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+static portMUX_TYPE led_lock = portMUX_INITIALIZER_UNLOCKED;
+#define LED_LOCK()      taskENTER_CRITICAL(&led_lock)
+#define LED_UNLOCK()    taskEXIT_CRITICAL(&led_lock)
+#else
+#define LED_LOCK()
+#define LED_UNLOCK()
+#endif
+
+// Perceived brightness is roughly the drive level to the power 1/2.2
+#define LED_GAMMA 2.2f
+
+static led_color_t back[LED_COUNT];     // drawn into
+static led_color_t front[LED_COUNT];    // last committed frame
+static uint64_t dirty;                  // back buffer pixels written since the last commit
+static led_stats_t stats;
+
+// The front buffer as it goes on the wire, one RMT symbol per bit. Only
+// changed LEDs are re-encoded, and the driver sends it without touching a bit.
+static uint32_t wire[LED_COUNT * LED_SYMBOLS_PER_LED];
+
+// Colour value to its 8 wire symbols, gamma and brightness applied. Rebuilt
+// only when the brightness changes, so encoding is three 32 byte copies per LED.
+static uint8_t gamma_lut[256];
+static uint32_t channel_symbols[256][8];
+static uint8_t brightness;              // level the tables are built for
+static volatile uint8_t brightness_request = LED_BRIGHTNESS_MED;
+
+static bool same_color(led_color_t a, led_color_t b) {
+    return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+static void build_tables(uint8_t level) {
+    for (int v = 0; v < 256; v++) {
+        uint8_t out = (uint8_t)((gamma_lut[v] * level + 127) / 255);
+        for (int bit = 0; bit < 8; bit++) {
+            channel_symbols[v][bit] = (out & (0x80 >> bit)) ? LED_SYMBOL_1 : LED_SYMBOL_0;
+        }
+    }
+    brightness = level;
+}
+
+static void encode_leds(uint64_t leds) {
+    while (leds) {
+        int sq = __builtin_ctzll(leds);
+        leds &= leds - 1;
+        uint32_t *out = &wire[sq * LED_SYMBOLS_PER_LED];
+        memcpy(out, channel_symbols[front[sq].g], sizeof(channel_symbols[0]));
+        memcpy(out + 8, channel_symbols[front[sq].r], sizeof(channel_symbols[0]));
+        memcpy(out + 16, channel_symbols[front[sq].b], sizeof(channel_symbols[0]));
+    }
+}
+
+void led_display_init(void) {
+    led_compose_init();
+    for (int v = 0; v < 256; v++) {
+        gamma_lut[v] = (uint8_t)(powf(v / 255.0f, LED_GAMMA) * 255.0f + 0.5f);
+    }
+    build_tables(brightness_request);
+    led_hw_init();
+    memset(back, 0, sizeof(back));
+    memset(front, 0, sizeof(front));
+    memset(&stats, 0, sizeof(stats));
+    // The strip powers up in an unknown state, so the first commit sends everything
+    encode_leds(~0ULL);
+    dirty = ~0ULL;
+    led_commit();
+}
+
+void led_set_brightness(uint8_t level) {
+    brightness_request = level;
+}
+
+uint8_t led_get_brightness(void) {
+    return brightness_request;
+}
+
+void led_set(int sq, led_color_t color) {
+    LED_LOCK();
+    back[sq] = color;
+    dirty |= 1ULL << sq;
+    LED_UNLOCK();
+}
+
+void led_fill(uint64_t squares, led_color_t color) {
+    LED_LOCK();
+    dirty |= squares;
+    while (squares) {
+        back[__builtin_ctzll(squares)] = color;
+        squares &= squares - 1;
+    }
+    LED_UNLOCK();
+}
+
+void led_clear(void) {
+    led_fill(~0ULL, LED_OFF);
+}
+
+void led_set_frame(const led_color_t frame[LED_COUNT]) {
+    LED_LOCK();
+    memcpy(back, frame, sizeof(back));
+    dirty = ~0ULL;
+    LED_UNLOCK();
+}
+
+bool led_commit(void) {
+    // The wire buffer may still be going out
+    led_hw_wait_done();
+
+    // A new brightness changes the encoding of every lit LED
+    uint64_t reencode = 0;
+    uint8_t level = brightness_request;
+    if (level != brightness) {
+        build_tables(level);
+        for (int sq = 0; sq < LED_COUNT; sq++) {
+            if (!same_color(front[sq], LED_OFF)) {
+                reencode |= 1ULL << sq;
+            }
+        }
+    }
+
+    // Swap in the dirty pixels that really changed colour. Writes to the same
+    // colour, or changed and then changed back, cost nothing on the wire.
+    LED_LOCK();
+    uint64_t candidates = dirty;
+    uint64_t changed = 0;
+    dirty = 0;
+    while (candidates) {
+        int sq = __builtin_ctzll(candidates);
+        candidates &= candidates - 1;
+        if (!same_color(back[sq], front[sq])) {
+            front[sq] = back[sq];
+            changed |= 1ULL << sq;
+        }
+    }
+    LED_UNLOCK();
+
+    stats.commits++;
+    reencode |= changed;
+    if (reencode == 0 && stats.transmits > 0) {
+        stats.skipped++;
+        return false;
+    }
+    encode_leds(reencode);
+
+    // LEDs past the last changed one keep their latched colour
+    int count = reencode ? 64 - __builtin_clzll(reencode) : LED_COUNT;
+    led_hw_transmit(wire, count * LED_SYMBOLS_PER_LED);
+    stats.transmits++;
+    stats.leds_sent += count;
+    stats.pixels_changed += __builtin_popcountll(changed);
+    return true;
+}
+
+void led_get_stats(led_stats_t *out) {
+    *out = stats;
+}
+
+// Animations (led_anim_t), all in microseconds
+#define LED_FADE_US         2000000     // a fade runs out over this long
+#define LED_PULSE_US        1000000     // pulse period
+#define LED_PULSE_FLOOR     48          // dimmest point of a pulse, out of 255
+#define LED_FLASH_US        250000      // flash, half on and half off
+
+// Written by led_post() under the lock, taken by the frame tick
+static uint64_t posted[LED_LAYER_COUNT];
+static uint32_t posted_mask;            // layers with a post waiting
+static bool posted_event;               // the posts include a board event's result
+
+// Owned by the frame tick
+static uint64_t shown[LED_LAYER_COUNT];
+static int64_t shown_since_us[LED_LAYER_COUNT];
+static uint8_t rendered_brightness;
+
+void led_post(led_layer_t layer, uint64_t squares) {
+    LED_LOCK();
+    stats.posts++;
+    if (posted_mask & (1u << layer)) {
+        stats.coalesced++;
+    }
+    posted[layer] = squares;
+    posted_mask |= 1u << layer;
+    LED_UNLOCK();
+}
+
+void led_post_event_done(void) {
+    LED_LOCK();
+    posted_event = true;
+    LED_UNLOCK();
+}
+
+static led_color_t scale(led_color_t color, uint32_t level) {
+    return LED_RGB(color.r * level / 255, color.g * level / 255, color.b * level / 255);
+}
+
+// Level of an animation elapsed_us after it started, 0-255. Clears *still
+// while it keeps changing by itself.
+static uint32_t anim_level(led_anim_t anim, int64_t elapsed_us, bool *still) {
+    switch (anim) {
+        case LED_ANIM_FADE:
+            if (elapsed_us >= LED_FADE_US) {
+                return 0;
+            }
+            *still = false;
+            return 255 - (uint32_t)(elapsed_us * 255 / LED_FADE_US);
+        case LED_ANIM_PULSE: {
+            // Triangle wave between the floor and full
+            *still = false;
+            int64_t phase = elapsed_us % LED_PULSE_US;
+            int64_t ramp = (phase < LED_PULSE_US / 2) ? phase : LED_PULSE_US - phase;
+            return 255 - (uint32_t)(ramp * 2 * (255 - LED_PULSE_FLOOR) / LED_PULSE_US);
+        }
+        case LED_ANIM_FLASH:
+            *still = false;
+            return ((elapsed_us / LED_FLASH_US) & 1) ? 0 : 255;
+        default:
+            return 255;
+    }
+}
+
+bool led_scheduler_frame(int64_t now_us) {
+    static bool still = true;
+
+    LED_LOCK();
+    uint32_t mask = posted_mask;
+    bool event = posted_event;
+    uint64_t taken[LED_LAYER_COUNT];
+    memcpy(taken, posted, sizeof(taken));
+    posted_mask = 0;
+    posted_event = false;
+    LED_UNLOCK();
+
+    for (int layer = 0; layer < LED_LAYER_COUNT; layer++) {
+        if ((mask & (1u << layer)) && taken[layer] != shown[layer]) {
+            shown[layer] = taken[layer];
+            shown_since_us[layer] = now_us;
+            still = false;
+        }
+    }
+    // Nothing new and nothing moving: the LEDs already show this frame
+    if (still && brightness_request == rendered_brightness) {
+        if (event) {
+            latency_stamp(LATENCY_LED);
+        }
+        stats.idle_frames++;
+        return false;
+    }
+
+    // Animation is applied per layer, not per square. A layer that has faded
+    // out drops its squares so lower layers show through.
+    uint64_t layers[LED_LAYER_COUNT];
+    led_color_t colors[LED_LAYER_COUNT];
+    still = true;
+    for (int layer = 0; layer < LED_LAYER_COUNT; layer++) {
+        const led_layer_style_t *style = &led_layer_styles[layer];
+        uint32_t level = shown[layer] ? anim_level(style->anim, now_us - shown_since_us[layer], &still) : 0;
+        layers[layer] = level ? shown[layer] : 0;
+        colors[layer] = scale(style->color, level);
+    }
+    led_color_t frame[LED_COUNT];
+    led_compose(layers, colors, frame);
+    led_set_frame(frame);
+    led_commit();
+    if (event) {
+        latency_stamp(LATENCY_LED);
+    }
+    rendered_brightness = brightness_request;
+    stats.frames++;
+    return true;
+}
+
+#ifdef ESP_PLATFORM
+#include "esp_err.h"
+#include "esp_timer.h"
+
+#define LED_TASK_PRIORITY 4             // below the scan task
+#define LED_TASK_STACK 3072
+
+static TaskHandle_t led_task_handle;
+
+static void led_frame_timer_callback(void *arg) {
+    xTaskNotifyGive(led_task_handle);
+}
+
+static void led_task(void *pvParameter) {
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        led_scheduler_frame(esp_timer_get_time());
+    }
+}
+
+void led_scheduler_start(void) {
+    xTaskCreate(led_task, "led_task", LED_TASK_STACK, NULL, LED_TASK_PRIORITY, &led_task_handle);
+    const esp_timer_create_args_t timer_args = {
+        .callback = led_frame_timer_callback,
+        .name = "led_frame",
+    };
+    esp_timer_handle_t timer;
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &timer));
+    ESP_ERROR_CHECK(esp_timer_start_periodic(timer, 1000000 / LED_FRAME_HZ));
+}
+#endif
+
+// The straightforward encoder the tables replace: gamma, brightness and every
+// bit worked out per LED per frame
+static void encode_per_bit(const led_color_t *pixels, uint8_t level, uint32_t *out) {
+    for (int sq = 0; sq < LED_COUNT; sq++) {
+        uint8_t channels[3] = { pixels[sq].g, pixels[sq].r, pixels[sq].b };
+        for (int c = 0; c < 3; c++) {
+            uint8_t corrected = (uint8_t)(powf(channels[c] / 255.0f, LED_GAMMA) * 255.0f + 0.5f);
+            uint8_t value = (uint8_t)((corrected * level + 127) / 255);
+            for (int bit = 7; bit >= 0; bit--) {
+                *out++ = (value >> bit) & 1 ? LED_SYMBOL_1 : LED_SYMBOL_0;
+            }
+        }
+    }
+}
+
+void led_display_bench(int rounds, led_bench_t *result) {
+    static uint32_t reference[LED_COUNT * LED_SYMBOLS_PER_LED];
+    memset(result, 0, sizeof(*result));
+
+    // A frame where every LED differs from the last one
+    led_color_t frame[2][LED_COUNT];
+    for (int sq = 0; sq < LED_COUNT; sq++) {
+        frame[0][sq] = LED_RGB(sq * 4, 255 - sq * 4, (sq * 37) & 255);
+        frame[1][sq] = LED_RGB(255 - sq * 4, sq * 4, (sq * 91) & 255);
+    }
+
+    led_hw_wait_done();
+    int64_t start = time_now_us();
+    for (int r = 0; r < rounds; r++) {
+        memcpy(front, frame[r & 1], sizeof(front));
+        encode_leds(~0ULL);
+    }
+    result->encode_ns = (time_now_us() - start) * 1000 / rounds;
+
+    start = time_now_us();
+    for (int r = 0; r < rounds; r++) {
+        encode_per_bit(frame[r & 1], brightness, reference);
+    }
+    result->encode_per_bit_ns = (time_now_us() - start) * 1000 / rounds;
+
+    // Both encoders must put the same bits on the wire
+    encode_per_bit(frame[(rounds - 1) & 1], brightness, reference);
+    result->mismatches = memcmp(wire, reference, sizeof(wire)) != 0;
+
+    start = time_now_us();
+    for (int r = 0; r < rounds; r++) {
+        led_set_frame(frame[r & 1]);
+        led_commit();
+        led_hw_wait_done();
+    }
+    result->commit_ns = (time_now_us() - start) * 1000 / rounds;
+    result->wire_us = LED_COUNT * LED_SYMBOLS_PER_LED * LED_BIT_NS / 1000;
+
+    led_clear();
+    led_commit();
+}
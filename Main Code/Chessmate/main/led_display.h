@@ -0,0 +1,116 @@
+// led_display.h
+#ifndef LED_DISPLAY_H
+#define LED_DISPLAY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// One addressable LED under every square, chained in square order (a1 first)
+#define LED_COUNT 64
+
+// Channels in the order the WS2812 takes them
+typedef struct {
+    uint8_t g;
+    uint8_t r;
+    uint8_t b;
+} led_color_t;
+
+#define LED_RGB(red, green, blue) ((led_color_t){ .g = (green), .r = (red), .b = (blue) })
+#define LED_OFF LED_RGB(0, 0, 0)
+
+// Overall brightness levels offered in the menu
+#define LED_BRIGHTNESS_LOW  32
+#define LED_BRIGHTNESS_MED  96
+#define LED_BRIGHTNESS_HIGH 255
+
+typedef struct {
+    uint32_t commits;           // led_commit() calls
+    uint32_t transmits;         // commits that sent a frame
+    uint32_t skipped;           // commits with nothing changed, so nothing sent
+    uint32_t leds_sent;         // LED values put on the wire
+    uint32_t pixels_changed;    // LEDs that actually changed colour
+    uint32_t frames;            // frame clock ticks that rendered and committed
+    uint32_t idle_frames;       // ticks with nothing posted and nothing animating
+    uint32_t posts;             // led_post() calls
+    uint32_t coalesced;         // posts replaced by a newer one before a frame took them
+} led_stats_t;
+
+// Sets up the LED driver and blanks the strip
+void led_display_init(void);
+
+// Drawing goes to the back buffer and is not visible until led_commit().
+// Any task may draw while a frame is being sent.
+void led_set(int sq, led_color_t color);
+void led_fill(uint64_t squares, led_color_t color);
+void led_clear(void);
+
+// Replaces the whole back buffer in one step, so a commit from another task
+// can never pick up half of it
+void led_set_frame(const led_color_t frame[LED_COUNT]);
+
+// Copies what changed in the back buffer into the front buffer and sends it.
+// A WS2812 chain is shifted from the first LED, so only the LEDs up to the
+// last changed one go out; with nothing changed nothing is sent and this
+// returns false. Waits for the previous frame to finish first, so the frame
+// on the wire is never modified while it goes out. Only one task commits.
+bool led_commit(void);
+
+void led_get_stats(led_stats_t *stats);
+
+// Scales every LED, after gamma correction. Takes effect with the next
+// led_commit(), which rebuilds the encoding tables and resends what is lit.
+void led_set_brightness(uint8_t level);
+uint8_t led_get_brightness(void);
+
+// Overlays the LEDs can show, each a bitboard. Producers post these and
+// never draw directly; the frame clock composites whatever is posted at
+// LED_FRAME_HZ (led_compose.h), so LEDs go out at most once per frame however
+// many events arrive in between. Colours, priorities and animations are in
+// led_layer_styles.
+typedef enum {
+    LED_LAYER_LAST_MOVE,    // from and to of the last move
+    LED_LAYER_THREATENED,   // pieces either side can lose, see_label_pieces()
+    LED_LAYER_HINT,         // from and to of the assist hint
+    LED_LAYER_TARGETS,      // legal targets of the lifted piece
+    LED_LAYER_CHECK,        // king in check
+    LED_LAYER_ILLEGAL,      // squares that make the board illegal
+    LED_LAYER_COUNT
+} led_layer_t;
+
+#define LED_FRAME_HZ 50
+
+// Replaces a layer's squares; 0 turns it off. Safe from any task and never
+// blocks. A pending post of the same layer is overwritten, and posting the
+// squares already shown does not restart the animation.
+void led_post(led_layer_t layer, uint64_t squares);
+
+// Marks everything posted so far as the result of the board event being
+// handled. The frame that takes those posts stamps LATENCY_LED (latency.h),
+// whether or not it changes a LED, so fades and pulses rendered in between
+// do not count as the result.
+void led_post_event_done(void);
+
+// Starts the frame clock and the task that renders and commits. From then on
+// only that task calls led_commit().
+void led_scheduler_start(void);
+
+// One frame clock tick: takes the pending posts, advances the animations to
+// now_us, and renders and commits if anything can have changed. Returns true
+// if a frame was rendered. The frame task calls this; the host drives it
+// directly.
+bool led_scheduler_frame(int64_t now_us);
+
+// Cost of getting a full 64 LED frame out, measured the same way on the board
+// and in the host build
+typedef struct {
+    int64_t encode_ns;          // all 64 LEDs from the precomputed tables
+    int64_t encode_per_bit_ns;  // same frame with gamma, brightness and bits computed per LED
+    int64_t commit_ns;          // led_commit() of a fully changed frame until it is on the wire
+    int64_t wire_us;            // time the frame takes on the wire at 800 kbit/s
+    uint32_t mismatches;        // frames where the two encoders disagreed
+} led_bench_t;
+
+// Changes the LEDs while it runs and leaves them off
+void led_display_bench(int rounds, led_bench_t *result);
+
+#endif // LED_DISPLAY_H
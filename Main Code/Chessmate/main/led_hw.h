@@ -0,0 +1,40 @@
+// led_hw.h
+#ifndef LED_HW_H
+#define LED_HW_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Wire driver behind led_display.c: led_strip.c on the ESP32
+
+// WS2812 bit timing in ticks of a 10 MHz RMT clock (0.1 us)
+#define LED_RMT_RESOLUTION_HZ 10000000
+#define LED_T0H_TICKS 3             // 0.3 us high, 0.9 us low for a 0
+#define LED_T0L_TICKS 9
+#define LED_T1H_TICKS 9             // 0.9 us high, 0.3 us low for a 1
+#define LED_T1L_TICKS 3
+#define LED_BIT_NS ((LED_T0H_TICKS + LED_T0L_TICKS) * 100)
+
+// Low time that latches a frame; newer WS2812B parts need more than 280 us
+#define LED_LATCH_US 300
+
+// One bit on the wire in the RMT symbol layout: high for high_ticks, then low
+// for low_ticks
+#define LED_SYMBOL(high_ticks, low_ticks) ((uint32_t)(high_ticks) | (1u << 15) | ((uint32_t)(low_ticks) << 16))
+#define LED_SYMBOL_0 LED_SYMBOL(LED_T0H_TICKS, LED_T0L_TICKS)
+#define LED_SYMBOL_1 LED_SYMBOL(LED_T1H_TICKS, LED_T1L_TICKS)
+
+// 24 bits per LED, green, red, blue, most significant bit first
+#define LED_SYMBOLS_PER_LED 24
+
+void led_hw_init(void);
+
+// Starts sending count already encoded symbols and returns without waiting.
+// The symbols must stay untouched until led_hw_wait_done() returns.
+void led_hw_transmit(const uint32_t *symbols, size_t count);
+
+// Blocks until the last transmit is on the wire. The latch gap before the
+// next frame is kept by led_hw_transmit().
+void led_hw_wait_done(void);
+
+#endif // LED_HW_H
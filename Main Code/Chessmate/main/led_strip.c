@@ -0,0 +1,58 @@
+//WS2812 driver for the square LEDs on the ESP32 RMT peripheral
+#include "driver/rmt_tx.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "esp_rom_sys.h"
+#include "soc/soc_caps.h"
+#include "led_hw.h"
+
+#ifdef CONFIG_CHESSMATE_LED_GPIO
+#define LED_GPIO CONFIG_CHESSMATE_LED_GPIO
+#else
+#define LED_GPIO 27
+#endif
+
+_Static_assert(sizeof(rmt_symbol_word_t) == sizeof(uint32_t), "LED_SYMBOL must match the RMT symbol layout");
+
+static rmt_channel_handle_t led_channel;
+static rmt_encoder_handle_t led_encoder;
+static int64_t frame_end_us;            // when the last frame's final bit goes out
+
+void led_hw_init(void) {
+    rmt_tx_channel_config_t channel_config = {
+        .gpio_num = LED_GPIO,
+        .clk_src = RMT_CLK_SRC_DEFAULT,
+        .resolution_hz = LED_RMT_RESOLUTION_HZ,
+        .trans_queue_depth = 1,
+#if SOC_RMT_SUPPORT_DMA
+        // The whole frame streams from memory without refill interrupts
+        .mem_block_symbols = 1024,
+        .flags.with_dma = 1,
+#else
+        .mem_block_symbols = 64,
+#endif
+    };
+    ESP_ERROR_CHECK(rmt_new_tx_channel(&channel_config, &led_channel));
+
+    // The frame is encoded by led_display.c ahead of time, so the driver only
+    // copies symbols into the RMT memory
+    rmt_copy_encoder_config_t encoder_config = {};
+    ESP_ERROR_CHECK(rmt_new_copy_encoder(&encoder_config, &led_encoder));
+    ESP_ERROR_CHECK(rmt_enable(led_channel));
+}
+
+void led_hw_transmit(const uint32_t *symbols, size_t count) {
+    // Back to back frames would run together without the latch gap
+    int64_t now_us = esp_timer_get_time();
+    if (now_us < frame_end_us + LED_LATCH_US) {
+        esp_rom_delay_us(frame_end_us + LED_LATCH_US - now_us);
+        now_us = frame_end_us + LED_LATCH_US;
+    }
+    rmt_transmit_config_t transmit_config = { .loop_count = 0 };
+    ESP_ERROR_CHECK(rmt_transmit(led_channel, led_encoder, symbols, count * sizeof(uint32_t), &transmit_config));
+    frame_end_us = now_us + count * LED_BIT_NS / 1000;
+}
+
+void led_hw_wait_done(void) {
+    ESP_ERROR_CHECK(rmt_tx_wait_all_done(led_channel, -1));
+}
@@ -1,7 +1,87 @@
 //Main Used to control all program flow
 #include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "scan_board.h"
+#include "board_events.h"
+#include "game.h"
+#include "latency.h"
+#include "led_display.h"
+
+// How often the scanner counters are logged
+#define STATS_PERIOD_MS 10000
+
+// Hint budget when there is no clock to take it from. The clock runs on the
+// LCD unit, which does not share state with this firmware yet.
+#define HINT_CLOCK_S 600
+
+static const char *TAG = "main";
+
+static void log_board_event(const board_event_t *event, void *ctx) {
+    ESP_LOGI(TAG, "%s %c%d at %lld us", event->type == BOARD_EVENT_LIFT ? "LIFT" : "PLACE",
+             'a' + (event->square & 7), (event->square >> 3) + 1, event->timestamp_us);
+}
+
+static void log_move(infer_status_t status, move_t move) {
+    char text[6];
+    switch (status) {
+        case INFER_COMPLETE:
+            move_to_string(move, text);
+            ESP_LOGI(TAG, "Move %s", text);
+            game_request_hint(HINT_CLOCK_S);
+            break;
+        case INFER_ILLEGAL:
+            ESP_LOGW(TAG, "Illegal move on the board");
+            break;
+        case INFER_PUT_BACK:
+            ESP_LOGI(TAG, "Pieces put back");
+            break;
+        default:
+            break;
+    }
+}
 
 void app_main(void)
 {
+    board_events_subscribe(log_board_event, NULL);
+    game_init(NULL);
+    game_set_move_callback(log_move);
+#if CONFIG_CHESSMATE_ASSIST_HIGH
+    game_set_assist_level(ASSIST_HIGH);
+    game_request_hint(HINT_CLOCK_S);
+#endif
+    led_display_init();
+    led_scheduler_start();
+    scan_board_start();
+
+    while (1) {
+        vTaskDelay(STATS_PERIOD_MS / portTICK_PERIOD_MS);
+
+        scan_stats_t stats;
+        scan_rates_t rates;
+        scan_get_stats(&stats);
+        scan_get_rates(&rates);
+        ESP_LOGI(TAG, "Scan: %lu frames, %lu processed, %lu dropped, %lu overruns, max queued %lu, %lu events",
+                 (unsigned long)stats.frames, (unsigned long)stats.processed, (unsigned long)stats.dropped_frames,
+                 (unsigned long)stats.ring_overruns, (unsigned long)stats.max_queued, (unsigned long)stats.events);
+        ESP_LOGI(TAG, "Scan rate: %.1f sweeps/s, CPU %.2f%%, burst %.0f%% of the time (%s now)",
+                 rates.sweeps_per_s, rates.duty_percent, rates.burst_percent, rates.burst ? "burst" : "idle");
+
+        uint32_t cache_hits, cache_rebuilds;
+        game_get_cache_stats(&cache_hits, &cache_rebuilds);
+        ESP_LOGI(TAG, "Target cache: %lu hits, %lu rebuilds", (unsigned long)cache_hits,
+                 (unsigned long)cache_rebuilds);
+
+        static char latency_text[1024];
+        latency_format(latency_text, sizeof(latency_text));
+        ESP_LOGI(TAG, "Lift-to-light latency:\n%s", latency_text);
 
-}
\ No newline at end of file
+        led_stats_t led;
+        led_get_stats(&led);
+        ESP_LOGI(TAG, "LEDs: %lu frames, %lu idle, %lu sent, %lu LEDs on the wire, %lu changed, %lu posts, %lu coalesced",
+                 (unsigned long)led.frames, (unsigned long)led.idle_frames, (unsigned long)led.transmits,
+                 (unsigned long)led.leds_sent, (unsigned long)led.pixels_changed, (unsigned long)led.posts,
+                 (unsigned long)led.coalesced);
+    }
+}
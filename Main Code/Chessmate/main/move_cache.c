@@ -0,0 +1,40 @@
+//Caches the legal targets of every piece between moves
+#include <string.h>
+#include "move_cache.h"
+
+void move_cache_init(move_cache_t *cache) {
+    memset(cache, 0, sizeof(*cache));
+}
+
+void move_cache_invalidate(move_cache_t *cache) {
+    cache->valid = false;
+}
+
+// The side to move changes with every move, so every entry changes too. One
+// generator pass fills the new entries, and only the squares filled last time
+// are cleared rather than the whole table.
+static void rebuild(move_cache_t *cache, const position_t *pos) {
+    uint64_t stale = cache->filled;
+    while (stale) {
+        cache->targets[bb_pop_lsb(&stale)] = 0;
+    }
+    cache->filled = generate_legal_targets(pos, cache->targets);
+    cache->key = pos->key;
+    cache->valid = true;
+    cache->rebuilds++;
+}
+
+void move_cache_update(move_cache_t *cache, const position_t *pos) {
+    if (!cache->valid || cache->key != pos->key) {
+        rebuild(cache, pos);
+    }
+}
+
+uint64_t move_cache_targets(move_cache_t *cache, const position_t *pos, int sq) {
+    if (!cache->valid || cache->key != pos->key) {
+        rebuild(cache, pos);
+    } else {
+        cache->hits++;
+    }
+    return cache->targets[sq];
+}
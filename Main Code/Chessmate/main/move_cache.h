@@ -0,0 +1,31 @@
+// move_cache.h
+#ifndef MOVE_CACHE_H
+#define MOVE_CACHE_H
+
+#include <stdint.h>
+#include "calculate_moves.h"
+
+// Legal destination masks for every square of the side to move, built once
+// per committed move so that a lifted piece is a single array read
+typedef struct {
+    uint64_t targets[64];
+    uint64_t key;           // Zobrist key of the position the table belongs to
+    uint64_t filled;        // squares with an entry from the last rebuild
+    bool valid;
+    uint32_t hits;          // lookups answered from the table
+    uint32_t rebuilds;      // times the table was regenerated
+} move_cache_t;
+
+void move_cache_init(move_cache_t *cache);
+
+// Drops the table, e.g. when the board is reset or set up by hand
+void move_cache_invalidate(move_cache_t *cache);
+
+// Call after a move is committed. Rebuilds the table if the position changed.
+void move_cache_update(move_cache_t *cache, const position_t *pos);
+
+// Legal targets of the piece on sq. Rebuilds first only if the table does not
+// belong to pos, which should not happen if move_cache_update is called on commit.
+uint64_t move_cache_targets(move_cache_t *cache, const position_t *pos, int sq);
+
+#endif // MOVE_CACHE_H
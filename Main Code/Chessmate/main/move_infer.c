@@ -0,0 +1,104 @@
+//Works out which chess move was played from the pieces lifted and placed
+#include <string.h>
+#include "move_infer.h"
+
+// No legal move changes the occupancy of more than four squares (castling)
+#define INFER_MAX_CHANGED 4
+
+// Squares whose occupancy the move changes at some point
+static uint64_t move_squares(move_t move, piece_color_t side) {
+    int to = MOVE_TO(move);
+    uint64_t squares = SQUARE_BB(MOVE_FROM(move)) | SQUARE_BB(to);
+    switch (MOVE_FLAGS(move)) {
+        case MOVE_EN_PASSANT:   return squares | SQUARE_BB((side == WHITE) ? to - 8 : to + 8);
+        case MOVE_CASTLE_KING:  return squares | SQUARE_BB(to + 1) | SQUARE_BB(to - 1);
+        case MOVE_CASTLE_QUEEN: return squares | SQUARE_BB(to - 2) | SQUARE_BB(to + 1);
+        default:                return squares;
+    }
+}
+
+// A normal capture leaves the target square occupied, so it only counts as
+// done once the captured piece has been taken off it
+static bool captures_in_place(move_t move) {
+    return MOVE_IS_CAPTURE(move) && MOVE_FLAGS(move) != MOVE_EN_PASSANT;
+}
+
+void move_infer_reset(move_infer_t *mi, const position_t *pos, uint64_t occupied) {
+    memset(mi->all, 0, sizeof(mi->all));
+    memset(mi->touching, 0, sizeof(mi->touching));
+    mi->side = pos->side_to_move;
+    mi->base = pos->occupied;
+    mi->occupied = occupied;
+    mi->removed = 0;
+
+    generate_legal_moves(pos, &mi->legal);
+    for (int i = 0; i < mi->legal.count; i++) {
+        uint64_t bit = 1ULL << (i & 63);
+        mi->all[i >> 6] |= bit;
+        uint64_t squares = move_squares(mi->legal.moves[i], mi->side);
+        while (squares) {
+            mi->touching[bb_pop_lsb(&squares)][i >> 6] |= bit;
+        }
+    }
+    memcpy(mi->candidates, mi->all, sizeof(mi->candidates));
+}
+
+infer_status_t move_infer_event(move_infer_t *mi, const board_event_t *event, move_t *move) {
+    uint64_t bit = SQUARE_BB(event->square);
+    if (event->type == BOARD_EVENT_LIFT) {
+        mi->occupied &= ~bit;
+        mi->removed |= bit & mi->base;
+    } else {
+        mi->occupied |= bit;
+    }
+
+    uint64_t changed = mi->occupied ^ mi->base;
+    if (changed == 0) {
+        mi->removed = 0;
+        memcpy(mi->candidates, mi->all, sizeof(mi->candidates));
+        return INFER_PUT_BACK;
+    }
+    if (bb_popcount(changed) > INFER_MAX_CHANGED) {
+        return INFER_ILLEGAL;
+    }
+
+    // A move fits if every square that differs from the position is one it
+    // changes. At most four squares differ, so this is a few word ANDs.
+    uint64_t any = 0;
+    for (int w = 0; w < INFER_MOVE_WORDS; w++) {
+        uint64_t fit = mi->all[w];
+        uint64_t squares = changed;
+        while (squares && fit) {
+            fit &= mi->touching[bb_pop_lsb(&squares)][w];
+        }
+        mi->candidates[w] = fit;
+        any |= fit;
+    }
+    if (any == 0) {
+        return INFER_ILLEGAL;
+    }
+
+    // Only moves from or onto the changed squares are left, so this loop is short
+    for (int w = 0; w < INFER_MOVE_WORDS; w++) {
+        uint64_t fit = mi->candidates[w];
+        while (fit) {
+            move_t m = mi->legal.moves[w * 64 + bb_pop_lsb(&fit)];
+            uint64_t final = move_squares(m, mi->side);
+            if (captures_in_place(m)) {
+                if (!(mi->removed & SQUARE_BB(MOVE_TO(m)))) {
+                    continue;
+                }
+                final &= ~SQUARE_BB(MOVE_TO(m));
+            }
+            // The sensors cannot tell pieces apart, so a promotion is a queen
+            if (MOVE_IS_PROMOTION(m) && MOVE_PROMOTION_PIECE(m) != QUEEN) {
+                continue;
+            }
+            if (changed == final) {
+                *move = m;
+                return INFER_COMPLETE;
+            }
+        }
+    }
+    return INFER_PENDING;
+}
@@ -0,0 +1,45 @@
+// move_infer.h
+#ifndef MOVE_INFER_H
+#define MOVE_INFER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "calculate_moves.h"
+#include "board_events.h"
+
+// Words in a bit set with one bit per entry of a move list
+#define INFER_MOVE_WORDS (MAX_MOVES / 64)
+
+typedef enum {
+    INFER_IDLE,         // the board matches the position
+    INFER_PENDING,      // pieces are moving and a legal move can still be completed
+    INFER_COMPLETE,     // the board now shows the position after a legal move
+    INFER_PUT_BACK,     // everything that was lifted went back where it was
+    INFER_ILLEGAL       // no legal move can explain the board
+} infer_status_t;
+
+// Matches physical board changes against the legal moves of one position.
+// Each move is indexed by the squares whose occupancy it changes (from, to,
+// the en passant victim, the castling rook's squares), so an event only ANDs
+// a few words instead of walking the move list.
+typedef struct {
+    move_list_t legal;
+    uint64_t all[INFER_MOVE_WORDS];                 // every legal move
+    uint64_t touching[64][INFER_MOVE_WORDS];        // moves that change each square
+    uint64_t candidates[INFER_MOVE_WORDS];          // moves that fit the board so far
+    uint64_t base;          // occupancy of the position
+    uint64_t occupied;      // occupancy of the physical board
+    uint64_t removed;       // occupied squares that were emptied at some point, e.g. a captured piece
+    piece_color_t side;     // side to move
+} move_infer_t;
+
+// Starts matching for pos. occupied is the physical board, normally equal to
+// pos->occupied; any difference has to be undone before a move is accepted.
+void move_infer_reset(move_infer_t *mi, const position_t *pos, uint64_t occupied);
+
+// Feeds one board event. When the status is INFER_COMPLETE the move is
+// written to *move; the caller plays it and calls move_infer_reset() for the
+// new position. A pawn reaching the last rank is taken as a queen.
+infer_status_t move_infer_event(move_infer_t *mi, const board_event_t *event, move_t *move);
+
+#endif // MOVE_INFER_H
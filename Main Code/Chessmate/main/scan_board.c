@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stdbool.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
@@ -7,26 +8,48 @@
 #include <unistd.h>
 #include "esp_timer.h"
 #include "esp_log.h"
-
+#include "esp_cpu.h"
+#include "esp_rom_sys.h"
+#include "soc/soc.h"
+#include "soc/gpio_reg.h"
+#include "scan_board.h"
+#include "scan_hw.h"
+#include "debounce.h"
+
+// Pins are set per board in menuconfig (ChessMate Board > Scanner pins)
 // GPIO Input Pin Definitions
-#define GPIO_HALL_EFFECT 25         // master signal in from the selected hall effect sensor
+#define GPIO_HALL_EFFECT CONFIG_CHESSMATE_HALL_GPIO         // master signal in from the selected hall effect sensor
 #define INPUT_BIT_MASK (1ULL<<GPIO_HALL_EFFECT)
 
 // GPIO Output Pin Definitions
-#define GPIO_MUX_SEL_1_1 17         // bit one to select signal on row selecting mux
-#define GPIO_MUX_SEL_1_2 25         // bit two to select signal on row selecting mux
-#define GPIO_MUX_SEL_1_3 5         // bit three to select signal on row selecting mux
-#define GPIO_MUX_SEL_2_1 22         // bit one to select signal on column selecting mux
-#define GPIO_MUX_SEL_2_2 14         // bit two to select signal on column selecting mux
-#define GPIO_MUX_SEL_2_3 19         // bit three to select signal on column selecting mux
+#define GPIO_MUX_SEL_1_1 CONFIG_CHESSMATE_MUX_ROW_SEL_1_GPIO    // bit one to select signal on row selecting mux
+#define GPIO_MUX_SEL_1_2 CONFIG_CHESSMATE_MUX_ROW_SEL_2_GPIO    // bit two to select signal on row selecting mux
+#define GPIO_MUX_SEL_1_3 CONFIG_CHESSMATE_MUX_ROW_SEL_3_GPIO    // bit three to select signal on row selecting mux
+#define GPIO_MUX_SEL_2_1 CONFIG_CHESSMATE_MUX_COL_SEL_1_GPIO    // bit one to select signal on column selecting mux
+#define GPIO_MUX_SEL_2_2 CONFIG_CHESSMATE_MUX_COL_SEL_2_GPIO    // bit two to select signal on column selecting mux
+#define GPIO_MUX_SEL_2_3 CONFIG_CHESSMATE_MUX_COL_SEL_3_GPIO    // bit three to select signal on column selecting mux
 #define OUTPUT_BIT_MASK ((1ULL<<GPIO_MUX_SEL_1_1) | (1ULL<<GPIO_MUX_SEL_1_2) | (1ULL<<GPIO_MUX_SEL_1_3) | (1ULL<<GPIO_MUX_SEL_2_1) | (1ULL<<GPIO_MUX_SEL_2_2) | (1ULL<<GPIO_MUX_SEL_2_3))
 
-#define scan_frequency 5
-static int clock_frequency_input = 1000000 / (scan_frequency * 64);
+// The mux and hall pins are read and written through the GPIO_IN/OUT
+// registers, which only cover GPIO 0-31
+_Static_assert((OUTPUT_BIT_MASK | INPUT_BIT_MASK) >> 32 == 0, "scan pins must be below GPIO 32");
+// Every mux step writes the output pins, so none of them can be the sensor input
+_Static_assert((INPUT_BIT_MASK & OUTPUT_BIT_MASK) == 0, "hall input pin is also a mux output");
+_Static_assert(__builtin_popcountll(OUTPUT_BIT_MASK) == 6, "mux select pins must be distinct");
+
+// Level the hall sensor input reads while a piece is on the selected square
+#define HALL_ACTIVE_LEVEL 1
+
+#define SCAN_TASK_PRIORITY 5
+#define SCAN_TASK_STACK 3072
 
-// create variables to iterate through the mux
-uint8_t row = 0;
-uint8_t col = 0;
+static const char *TAG = "scan_board";
+
+// GPIO output bits that are high for each mux select word
+static uint32_t mux_pin_levels[64];
+
+static esp_timer_handle_t periodic_timer;
+static TaskHandle_t scan_task_handle;
 
 void configure_input_GPIO() {
     gpio_config_t input_io_config;
@@ -48,69 +71,94 @@ void configure_output_GPIO() {
     gpio_config(&output_io_config);
 }
 
-void update_mux(uint8_t row, uint8_t col) {
-    // set the row and column mux
-    gpio_set_level(GPIO_MUX_SEL_1_1, (row & 0x01) >> 0);
-    gpio_set_level(GPIO_MUX_SEL_1_2, (row & 0x02) >> 1);
-    gpio_set_level(GPIO_MUX_SEL_1_3, (row & 0x04) >> 2);
-    gpio_set_level(GPIO_MUX_SEL_2_1, (col & 0x01) >> 0);
-    gpio_set_level(GPIO_MUX_SEL_2_2, (col & 0x02) >> 1);
-    gpio_set_level(GPIO_MUX_SEL_2_3, (col & 0x04) >> 2);
+void init_mux_tables(void) {
+    static const uint8_t select_pins[6] = {
+        GPIO_MUX_SEL_2_1, GPIO_MUX_SEL_2_2, GPIO_MUX_SEL_2_3,     // column
+        GPIO_MUX_SEL_1_1, GPIO_MUX_SEL_1_2, GPIO_MUX_SEL_1_3      // row
+    };
+    for (int i = 0; i < 64; i++) {
+        mux_pin_levels[i] = 0;
+        for (int bit = 0; bit < 6; bit++) {
+            if (i & (1 << bit)) {
+                mux_pin_levels[i] |= 1UL << select_pins[bit];
+            }
+        }
+    }
+}
+
+void update_mux(uint8_t from_sq, uint8_t to_sq) {
+    // set the row and column mux. Only the lines that differ are written,
+    // which in the Gray code scan order is a single write-1-to-set or
+    // write-1-to-clear.
+    uint32_t set = mux_pin_levels[to_sq] & ~mux_pin_levels[from_sq];
+    uint32_t clear = mux_pin_levels[from_sq] & ~mux_pin_levels[to_sq];
+    if (set) {
+        REG_WRITE(GPIO_OUT_W1TS_REG, set);
+    }
+    if (clear) {
+        REG_WRITE(GPIO_OUT_W1TC_REG, clear);
+    }
+}
+
+// Scanner backend for scan_core.c
+bool scan_hw_read_hall(void) {
+    return ((REG_READ(GPIO_IN_REG) >> GPIO_HALL_EFFECT) & 1) == HALL_ACTIVE_LEVEL;
+}
+
+void scan_hw_select(uint8_t from_sq, uint8_t to_sq) {
+    update_mux(from_sq, to_sq);
+}
+
+void scan_hw_set_period_us(uint32_t period_us) {
+    esp_timer_restart(periodic_timer, period_us);
+}
+
+void scan_hw_frame_ready(void) {
+    xTaskNotifyGive(scan_task_handle);
+}
+
+int64_t scan_hw_time_us(void) {
+    return esp_timer_get_time();
+}
+
+uint32_t scan_hw_cycles(void) {
+    return esp_cpu_get_cycle_count();
 }
 
-static void periodic_timer_callback(void* arg);
+uint32_t scan_hw_cycles_per_us(void) {
+    return esp_rom_get_cpu_ticks_per_us();
+}
+
+static void periodic_timer_callback(void* arg) {
+    scan_core_sample();
+}
+
+// Does all the work on finished sweeps, outside the timer path
+static void scan_task(void *pvParameter) {
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        scan_core_process();
+    }
+}
 
-void app_main(void)
-{
+void scan_board_start(void) {
+    configure_input_GPIO();
     configure_output_GPIO();
+    init_mux_tables();
+    // the scan starts on square 0, which has every select line low
+    REG_WRITE(GPIO_OUT_W1TC_REG, (uint32_t)OUTPUT_BIT_MASK);
 
     const esp_timer_create_args_t periodic_timer_args = {
             .callback = &periodic_timer_callback,
             .name = "periodic"
     };
-
-    esp_timer_handle_t periodic_timer;
     ESP_ERROR_CHECK(esp_timer_create(&periodic_timer_args, &periodic_timer));
+    uint32_t period_us = scan_core_init();
 
-    // // temp code to test the mux
-    // gpio_set_level(GPIO_MUX_SEL_1_1, 0);
-    // gpio_set_level(GPIO_MUX_SEL_1_2, 0);
-    // gpio_set_level(GPIO_MUX_SEL_1_3, 0);
-    // gpio_set_level(GPIO_MUX_SEL_2_1, 0);
-    // gpio_set_level(GPIO_MUX_SEL_2_2, 0);
-    // gpio_set_level(GPIO_MUX_SEL_2_3, 0);
+    xTaskCreate(scan_task, "scan_task", SCAN_TASK_STACK, NULL, SCAN_TASK_PRIORITY, &scan_task_handle);
 
     // start clock
-    ESP_ERROR_CHECK(esp_timer_start_periodic(periodic_timer, clock_frequency_input));
-
-    while (1) {
-        // 100ms delay
-        vTaskDelay(100 / portTICK_PERIOD_MS);
-    }
+    ESP_ERROR_CHECK(esp_timer_start_periodic(periodic_timer, period_us));
+    ESP_LOGI(TAG, "Scanning with a %lu us sample period, %d sample debounce", (unsigned long)period_us,
+             DEBOUNCE_SAMPLES);
 }
-
-static void periodic_timer_callback(void* arg) {
-    // update the mux
-    update_mux(row, col);
-
-    // read the value of the hall effect sensor
-    int hall_effect_value = gpio_get_level(GPIO_HALL_EFFECT);
-    if (hall_effect_value == 1) {
-        printf("Hall Effect Value: %d\n", hall_effect_value);
-        printf("Row: %d\n", row);
-        printf("Col: %d\n", col);
-    }
-
-    update the row and column
-    if (col == 7) {
-        if (row == 7) {
-            row = 0;
-            col = 0;
-        } else {
-            row++;
-            col = 0;
-        }
-    } else {
-        col++;
-    }
-}
\ No newline at end of file
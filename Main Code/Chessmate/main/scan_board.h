@@ -0,0 +1,43 @@
+// scan_board.h
+#ifndef SCAN_BOARD_H
+#define SCAN_BOARD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Scanner health, all counted since scan_board_start()
+typedef struct {
+    uint32_t frames;            // sweeps pushed into the ring
+    uint32_t processed;         // frames handled by the scan task
+    uint32_t dropped_frames;    // sweeps lost because the ring was full
+    uint32_t ring_overruns;     // times the ring filled up, each losing one or more sweeps
+    uint32_t max_queued;        // most frames ever waiting for the scan task
+    uint32_t events;            // LIFT and PLACE events sent to subscribers
+    uint32_t burst_entries;     // switches from the idle to the burst scan rate
+    uint32_t burst_sweeps;      // sweeps made at the burst rate
+    uint32_t timer_busy_us;     // CPU time spent in the scan timer callback
+    uint32_t task_busy_us;      // CPU time spent processing sweeps in the scan task
+} scan_stats_t;
+
+// Scan load measured between two scan_get_rates() calls
+typedef struct {
+    float sweeps_per_s;         // effective full-board scan rate
+    float duty_percent;         // share of one core spent in the timer callback and scan task
+    float burst_percent;        // share of the time spent at the burst rate
+    bool burst;                 // scanning at the burst rate right now
+} scan_rates_t;
+
+// Configures the mux and hall GPIOs, then starts the scan timer and the task
+// that processes finished sweeps. Changes are delivered as board events, so
+// subscribe with board_events_subscribe() before starting.
+void scan_board_start(void);
+
+// Debounced occupancy after the newest processed sweep, bit per square (a1 = bit 0)
+uint64_t scan_board_occupancy(void);
+
+void scan_get_stats(scan_stats_t *stats);
+
+// Rates since the previous call (or since scan_board_start() for the first)
+void scan_get_rates(scan_rates_t *rates);
+
+#endif // SCAN_BOARD_H
@@ -0,0 +1,206 @@
+//Board scan logic shared by the ESP32 and the host simulator
+#include <string.h>
+#include "scan_board.h"
+#include "scan_hw.h"
+#include "scan_ring.h"
+#include "board_events.h"
+#include "debounce.h"
+
+// Full-board sweeps per second. An idle board is swept slowly; the moment a
+// square reads differently from the last sweep the scan switches to the burst
+// rate, and stays there until the raw readings have not changed for
+// SCAN_SETTLE_MS.
+#define scan_idle_frequency 10
+#define scan_burst_frequency 80
+#define SCAN_SETTLE_MS 500
+#define SCAN_PERIOD_US(frequency) (1000000 / ((frequency) * 64))
+#define SCAN_SETTLE_SWEEPS (scan_burst_frequency * SCAN_SETTLE_MS / 1000)
+_Static_assert(SCAN_SETTLE_SWEEPS > DEBOUNCE_SAMPLES, "burst must outlast the debounce");
+
+// Squares in scan order. The mux select word is the square number (column in
+// bits 0-2, row in bits 3-5), and the order is a 6-bit Gray code over it, so
+// each step, including the wrap back to the start, flips one select line.
+static uint8_t scan_order[64];
+static uint8_t scan_step;
+
+// Written only by the sample path
+static uint64_t sweep_bits;             // squares read active so far in this sweep
+static uint64_t last_sweep_bits;        // raw readings of the previous sweep
+static uint32_t sweep_sequence;
+static uint32_t quiet_sweeps;           // sweeps in a row that matched the previous one
+static bool burst;
+static uint32_t sample_cycles;          // sample time not yet added to stats.timer_busy_us
+static bool ring_was_full;
+static scan_ring_t scan_ring;
+static scan_stats_t stats;
+
+// Written only by the processing side
+static debounce_t debounce;
+static uint64_t current_occupancy;
+static bool first_frame;
+static uint32_t process_cycles;
+static uint64_t unsettled;              // squares whose raw reading disagrees with the debounced state
+static int64_t sampled_us[64];          // when each unsettled square started to disagree
+
+// Previous scan_get_rates() call
+static scan_stats_t rates_last;
+static int64_t rates_last_us;
+
+uint32_t scan_core_init(void) {
+    for (int i = 0; i < 64; i++) {
+        scan_order[i] = i ^ (i >> 1);
+    }
+    scan_step = 0;
+    sweep_bits = 0;
+    last_sweep_bits = 0;
+    sweep_sequence = 0;
+    quiet_sweeps = 0;
+    burst = false;
+    sample_cycles = 0;
+    ring_was_full = false;
+    scan_ring_init(&scan_ring);
+    memset(&stats, 0, sizeof(stats));
+    current_occupancy = 0;
+    first_frame = true;
+    process_cycles = 0;
+    unsettled = 0;
+    memset(&rates_last, 0, sizeof(rates_last));
+    rates_last_us = scan_hw_time_us();
+    return SCAN_PERIOD_US(scan_idle_frequency);
+}
+
+static void set_burst(bool on) {
+    burst = on;
+    quiet_sweeps = 0;
+    if (on) {
+        stats.burst_entries++;
+    }
+    scan_hw_set_period_us(SCAN_PERIOD_US(on ? scan_burst_frequency : scan_idle_frequency));
+}
+
+// Publishes a finished sweep. Runs in the timer path, so it only touches
+// memory: no I/O, no allocation and no locks.
+static void publish_sweep(void) {
+    scan_frame_t frame = {
+        .occupancy = sweep_bits,
+        .timestamp_us = scan_hw_time_us(),
+        .sequence = sweep_sequence++,
+    };
+
+    if (burst) {
+        stats.burst_sweeps++;
+        quiet_sweeps = (sweep_bits == last_sweep_bits) ? quiet_sweeps + 1 : 0;
+        if (quiet_sweeps >= SCAN_SETTLE_SWEEPS) {
+            set_burst(false);
+        }
+    }
+    last_sweep_bits = sweep_bits;
+    sweep_bits = 0;
+
+    if (!scan_ring_push(&scan_ring, &frame)) {
+        stats.dropped_frames++;
+        if (!ring_was_full) {
+            stats.ring_overruns++;
+            ring_was_full = true;
+        }
+        return;
+    }
+    ring_was_full = false;
+    stats.frames++;
+
+    unsigned queued = scan_ring_count(&scan_ring);
+    if (queued > stats.max_queued) {
+        stats.max_queued = queued;
+    }
+    scan_hw_frame_ready();
+}
+
+void scan_core_sample(void) {
+    uint32_t start_cycles = scan_hw_cycles();
+    uint8_t sq = scan_order[scan_step];
+    uint64_t bit = 1ULL << sq;
+
+    if (scan_hw_read_hall()) {
+        sweep_bits |= bit;
+    }
+    // a square that changed since the last sweep means a piece is moving
+    if (!burst && ((sweep_bits ^ last_sweep_bits) & bit)) {
+        set_burst(true);
+    }
+
+    // select the next square right away, so the mux has a whole timer period
+    // to settle before it is read
+    scan_step = (scan_step + 1) & 63;
+    scan_hw_select(sq, scan_order[scan_step]);
+
+    if (scan_step == 0) {
+        publish_sweep();
+    }
+
+    sample_cycles += scan_hw_cycles() - start_cycles;
+    if (scan_step == 0) {
+        uint32_t cycles_per_us = scan_hw_cycles_per_us();
+        stats.timer_busy_us += sample_cycles / cycles_per_us;
+        sample_cycles %= cycles_per_us;
+    }
+}
+
+// Each sweep is debounced, then diffed against the last one so only changes
+// reach the subscribers
+void scan_core_process(void) {
+    uint32_t start_cycles = scan_hw_cycles();
+    scan_frame_t frame;
+    while (scan_ring_pop(&scan_ring, &frame)) {
+        if (first_frame) {
+            // Pieces already on the board at power up are not events
+            debounce_init(&debounce, frame.occupancy);
+            board_events_reset(frame.occupancy);
+            first_frame = false;
+        } else {
+            // Remember the sweep that first read each change, so latency is
+            // measured from the sensor rather than from the debounce
+            uint64_t disagree = frame.occupancy ^ debounce.stable;
+            uint64_t fresh = disagree & ~unsettled;
+            while (fresh) {
+                sampled_us[__builtin_ctzll(fresh)] = frame.timestamp_us;
+                fresh &= fresh - 1;
+            }
+            unsettled = disagree;
+
+            uint64_t stable = debounce_update(&debounce, frame.occupancy);
+            stats.events += board_events_process(stable, frame.timestamp_us, sampled_us);
+        }
+        current_occupancy = debounce.stable;
+        stats.processed++;
+    }
+
+    uint32_t cycles_per_us = scan_hw_cycles_per_us();
+    process_cycles += scan_hw_cycles() - start_cycles;
+    stats.task_busy_us += process_cycles / cycles_per_us;
+    process_cycles %= cycles_per_us;
+}
+
+uint64_t scan_board_occupancy(void) {
+    return current_occupancy;
+}
+
+void scan_get_stats(scan_stats_t *out) {
+    *out = stats;
+}
+
+void scan_get_rates(scan_rates_t *rates) {
+    scan_stats_t now = stats;
+    int64_t now_us = scan_hw_time_us();
+    float window_s = (now_us - rates_last_us) / 1e6f;
+    uint32_t sweeps = (now.frames + now.dropped_frames) - (rates_last.frames + rates_last.dropped_frames);
+    uint32_t burst_sweeps = now.burst_sweeps - rates_last.burst_sweeps;
+    uint32_t busy_us = (now.timer_busy_us - rates_last.timer_busy_us) + (now.task_busy_us - rates_last.task_busy_us);
+
+    rates->sweeps_per_s = window_s > 0 ? sweeps / window_s : 0;
+    rates->duty_percent = window_s > 0 ? busy_us / (window_s * 1e4f) : 0;
+    rates->burst_percent = window_s > 0 ? 100.0f * burst_sweeps / (scan_burst_frequency * window_s) : 0;
+    rates->burst = burst;
+
+    rates_last = now;
+    rates_last_us = now_us;
+}
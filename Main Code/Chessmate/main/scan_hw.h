@@ -0,0 +1,31 @@
+// scan_hw.h
+#ifndef SCAN_HW_H
+#define SCAN_HW_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// The scanner is split in two. scan_core.c holds the scan order, sweep
+// assembly, rate switching, ring, debounce and events, with no hardware
+// access. A backend drives it and provides the functions below:
+// scan_board.c on the ESP32, the simulator in the host build.
+
+// Implemented by the backend. The first four are called from the sample
+// timer path and must not block.
+bool scan_hw_read_hall(void);                           // sensor the mux selects sees a piece
+void scan_hw_select(uint8_t from_sq, uint8_t to_sq);    // switches the mux to the next square
+void scan_hw_set_period_us(uint32_t period_us);         // changes the sample timer period
+void scan_hw_frame_ready(void);                         // a sweep waits for scan_core_process()
+int64_t scan_hw_time_us(void);
+uint32_t scan_hw_cycles(void);                          // free running counter for busy time
+uint32_t scan_hw_cycles_per_us(void);
+
+// Called by the backend. scan_core_init() resets the scanner, which starts on
+// square 0, and returns the first sample period. scan_core_sample() runs on
+// every timer tick; scan_core_process() handles finished sweeps outside the
+// timer path.
+uint32_t scan_core_init(void);
+void scan_core_sample(void);
+void scan_core_process(void);
+
+#endif // SCAN_HW_H
@@ -0,0 +1,65 @@
+// scan_ring.h
+#ifndef SCAN_RING_H
+#define SCAN_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+// Frames the scanner can get ahead of the consumer task. Must be a power of two.
+#define SCAN_RING_SIZE 16
+
+// One full sweep of the 64 hall sensors
+typedef struct {
+    uint64_t occupancy;         // bit per square, set where a sensor reads a piece
+    int64_t timestamp_us;       // time the sweep finished
+    uint32_t sequence;          // sweep number, consecutive unless frames were dropped
+} scan_frame_t;
+
+// Lock-free ring for exactly one producer (the scan timer) and one consumer
+// (the scan task). Each side only writes its own index, so neither ever
+// blocks or disables interrupts.
+typedef struct {
+    scan_frame_t frames[SCAN_RING_SIZE];
+    atomic_uint head;           // next slot to write, owned by the producer
+    atomic_uint tail;           // next slot to read, owned by the consumer
+} scan_ring_t;
+
+static inline void scan_ring_init(scan_ring_t *ring) {
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+}
+
+// Producer side. Returns false, leaving the ring untouched, if it is full.
+static inline bool scan_ring_push(scan_ring_t *ring, const scan_frame_t *frame) {
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head - tail == SCAN_RING_SIZE) {
+        return false;
+    }
+    ring->frames[head & (SCAN_RING_SIZE - 1)] = *frame;
+    // Publish the frame before the index that makes it visible
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return true;
+}
+
+// Consumer side. Returns false if the ring is empty.
+static inline bool scan_ring_pop(scan_ring_t *ring, scan_frame_t *frame) {
+    unsigned tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (head == tail) {
+        return false;
+    }
+    *frame = ring->frames[tail & (SCAN_RING_SIZE - 1)];
+    // The slot may be reused once the new tail is seen
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+// Frames waiting for the consumer
+static inline unsigned scan_ring_count(scan_ring_t *ring) {
+    return atomic_load_explicit(&ring->head, memory_order_acquire)
+         - atomic_load_explicit(&ring->tail, memory_order_acquire);
+}
+
+#endif // SCAN_RING_H
@@ -0,0 +1,370 @@
+//Searches for the best move to show as a hint in "Assist: High"
+#include <string.h>
+#include "search.h"
+#include "transposition.h"
+#include "time_us.h"
+
+// Iterations stop once this share of the budget is used, since the next one
+// would rarely finish in the time left
+#define SOFT_LIMIT_DIVISOR  2
+// Nodes between clock reads; the stop flag is checked at every node
+#define CLOCK_CHECK_NODES   1024
+
+#define HINT_MIN_US         (100 * 1000)
+#define HINT_MAX_US         (10 * 1000 * 1000)
+
+static const int piece_values[6] = { 100, 320, 330, 500, 900, 0 };
+
+// Piece-square tables from White's side, drawn with row 8 at the top
+static const int8_t piece_squares[6][64] = {
+    {   0,   0,   0,   0,   0,   0,   0,   0,
+       50,  50,  50,  50,  50,  50,  50,  50,
+       10,  10,  20,  30,  30,  20,  10,  10,
+        5,   5,  10,  25,  25,  10,   5,   5,
+        0,   0,   0,  20,  20,   0,   0,   0,
+        5,  -5, -10,   0,   0, -10,  -5,   5,
+        5,  10,  10, -20, -20,  10,  10,   5,
+        0,   0,   0,   0,   0,   0,   0,   0 },
+    { -50, -40, -30, -30, -30, -30, -40, -50,
+      -40, -20,   0,   0,   0,   0, -20, -40,
+      -30,   0,  10,  15,  15,  10,   0, -30,
+      -30,   5,  15,  20,  20,  15,   5, -30,
+      -30,   0,  15,  20,  20,  15,   0, -30,
+      -30,   5,  10,  15,  15,  10,   5, -30,
+      -40, -20,   0,   5,   5,   0, -20, -40,
+      -50, -40, -30, -30, -30, -30, -40, -50 },
+    { -20, -10, -10, -10, -10, -10, -10, -20,
+      -10,   0,   0,   0,   0,   0,   0, -10,
+      -10,   0,   5,  10,  10,   5,   0, -10,
+      -10,   5,   5,  10,  10,   5,   5, -10,
+      -10,   0,  10,  10,  10,  10,   0, -10,
+      -10,  10,  10,  10,  10,  10,  10, -10,
+      -10,   5,   0,   0,   0,   0,   5, -10,
+      -20, -10, -10, -10, -10, -10, -10, -20 },
+    {   0,   0,   0,   0,   0,   0,   0,   0,
+        5,  10,  10,  10,  10,  10,  10,   5,
+       -5,   0,   0,   0,   0,   0,   0,  -5,
+       -5,   0,   0,   0,   0,   0,   0,  -5,
+       -5,   0,   0,   0,   0,   0,   0,  -5,
+       -5,   0,   0,   0,   0,   0,   0,  -5,
+       -5,   0,   0,   0,   0,   0,   0,  -5,
+        0,   0,   0,   5,   5,   0,   0,   0 },
+    { -20, -10, -10,  -5,  -5, -10, -10, -20,
+      -10,   0,   0,   0,   0,   0,   0, -10,
+      -10,   0,   5,   5,   5,   5,   0, -10,
+       -5,   0,   5,   5,   5,   5,   0,  -5,
+        0,   0,   5,   5,   5,   5,   0,  -5,
+      -10,   5,   5,   5,   5,   5,   0, -10,
+      -10,   0,   5,   0,   0,   0,   0, -10,
+      -20, -10, -10,  -5,  -5, -10, -10, -20 },
+    { -30, -40, -40, -50, -50, -40, -40, -30,
+      -30, -40, -40, -50, -50, -40, -40, -30,
+      -30, -40, -40, -50, -50, -40, -40, -30,
+      -30, -40, -40, -50, -50, -40, -40, -30,
+      -20, -30, -30, -40, -40, -30, -30, -20,
+      -10, -20, -20, -20, -20, -20, -20, -10,
+       20,  20,   0,   0,   0,   0,  20,  20,
+       20,  30,  10,   0,   0,  10,  30,  20 },
+};
+
+// Search state. Only one search runs at a time.
+static volatile bool stop_requested;
+static bool stopped;
+static int64_t deadline_us;
+static uint32_t nodes;
+static move_t root_best_move;
+static move_t killers[SEARCH_MAX_PLY][2];
+
+// Move lists live here rather than on the stack so the search task stays small
+static move_list_t ply_moves[SEARCH_MAX_PLY];
+static uint16_t ply_order[SEARCH_MAX_PLY][MAX_MOVES];
+
+int64_t search_budget_us(int remaining_s) {
+    // Spend about a sixtieth of the clock: 1 s in a 1 minute game, 10 s in a 10 minute game
+    int64_t budget = (int64_t)remaining_s * 1000000 / 60;
+    if (budget < HINT_MIN_US) {
+        budget = HINT_MIN_US;
+    }
+    if (budget > HINT_MAX_US) {
+        budget = HINT_MAX_US;
+    }
+    return budget;
+}
+
+void search_stop(void) {
+    stop_requested = true;
+}
+
+void search_arm(void) {
+    stop_requested = false;
+}
+
+int evaluate(const position_t *pos) {
+    int score = 0;
+    for (int type = PAWN; type <= KING; type++) {
+        uint64_t white = pos->pieces[WHITE][type];
+        uint64_t black = pos->pieces[BLACK][type];
+        score += piece_values[type] * (bb_popcount(white) - bb_popcount(black));
+        while (white) {
+            score += piece_squares[type][bb_pop_lsb(&white) ^ 56];
+        }
+        while (black) {
+            score -= piece_squares[type][bb_pop_lsb(&black)];
+        }
+    }
+    return (pos->side_to_move == WHITE) ? score : -score;
+}
+
+static bool is_root_move(move_t move) {
+    const move_list_t *root = &ply_moves[0];
+    for (int i = 0; i < root->count; i++) {
+        if (root->moves[i] == move) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Polled at every node, so a stop request is seen within one node
+static inline bool should_stop(void) {
+    if (stop_requested) {
+        stopped = true;
+    } else if ((++nodes & (CLOCK_CHECK_NODES - 1)) == 0 && time_now_us() >= deadline_us) {
+        stopped = true;
+    }
+    return stopped;
+}
+
+// Mate scores are stored relative to the node so they stay correct when the
+// same position is reached at a different ply
+static inline int score_to_tt(int score, int ply) {
+    if (score > SCORE_MATE - SEARCH_MAX_PLY) return score + ply;
+    if (score < -SCORE_MATE + SEARCH_MAX_PLY) return score - ply;
+    return score;
+}
+
+static inline int score_from_tt(int score, int ply) {
+    if (score > SCORE_MATE - SEARCH_MAX_PLY) return score - ply;
+    if (score < -SCORE_MATE + SEARCH_MAX_PLY) return score + ply;
+    return score;
+}
+
+// Hash move first, then captures by most valuable victim and least valuable
+// attacker, then killer moves
+static void order_moves(const position_t *pos, int ply, move_t hash_move) {
+    const move_list_t *list = &ply_moves[ply];
+    for (int i = 0; i < list->count; i++) {
+        move_t move = list->moves[i];
+        uint16_t score = 0;
+        if (move == hash_move) {
+            score = 60000;
+        } else if (MOVE_IS_CAPTURE(move)) {
+            uint8_t victim = pos->squares[MOVE_TO(move)];
+            int victim_type = (victim == EMPTY_SQUARE) ? PAWN : PIECE_TYPE(victim);
+            score = 50000 + victim_type * 8 - PIECE_TYPE(pos->squares[MOVE_FROM(move)]);
+        } else if (MOVE_IS_PROMOTION(move)) {
+            score = 49000 + (MOVE_FLAGS(move) & 3);
+        } else if (move == killers[ply][0]) {
+            score = 48000;
+        } else if (move == killers[ply][1]) {
+            score = 47000;
+        }
+        ply_order[ply][i] = score;
+    }
+}
+
+// Swaps the best remaining move into slot i and returns it
+static move_t pick_move(int ply, int i) {
+    move_list_t *list = &ply_moves[ply];
+    uint16_t *order = ply_order[ply];
+    int best = i;
+    for (int j = i + 1; j < list->count; j++) {
+        if (order[j] > order[best]) {
+            best = j;
+        }
+    }
+    move_t move = list->moves[best];
+    list->moves[best] = list->moves[i];
+    list->moves[i] = move;
+    uint16_t score = order[best];
+    order[best] = order[i];
+    order[i] = score;
+    return move;
+}
+
+// Resolves captures so the static evaluation is not taken mid-exchange
+static int quiescence(position_t *pos, int alpha, int beta, int ply) {
+    if (should_stop()) {
+        return 0;
+    }
+    bool checked = in_check(pos);
+    if (ply >= SEARCH_MAX_PLY - 1) {
+        return evaluate(pos);
+    }
+
+    if (!checked) {
+        int stand_pat = evaluate(pos);
+        if (stand_pat >= beta) {
+            return stand_pat;
+        }
+        if (stand_pat > alpha) {
+            alpha = stand_pat;
+        }
+    }
+
+    move_list_t *list = &ply_moves[ply];
+    generate_legal_moves(pos, list);
+    if (list->count == 0) {
+        return checked ? -SCORE_MATE + ply : 0;
+    }
+    order_moves(pos, ply, 0);
+
+    for (int i = 0; i < list->count; i++) {
+        move_t move = pick_move(ply, i);
+        // Out of check every evasion is searched, otherwise only captures and promotions
+        if (!checked && !MOVE_IS_CAPTURE(move) && !MOVE_IS_PROMOTION(move)) {
+            break;
+        }
+        make_move(pos, move);
+        int score = -quiescence(pos, -beta, -alpha, ply + 1);
+        unmake_move(pos);
+        if (stopped) {
+            return 0;
+        }
+        if (score >= beta) {
+            return score;
+        }
+        if (score > alpha) {
+            alpha = score;
+        }
+    }
+    return alpha;
+}
+
+static int alpha_beta(position_t *pos, int depth, int alpha, int beta, int ply) {
+    if (should_stop()) {
+        return 0;
+    }
+    // The root always searches its moves, so every iteration leaves a root move
+    if (ply > 0 && (position_is_repetition(pos) || pos->halfmove_clock >= 100)) {
+        return 0;
+    }
+    bool checked = in_check(pos);
+    if (checked) {
+        depth++;
+    }
+    if (depth <= 0 || ply >= SEARCH_MAX_PLY - 1) {
+        return quiescence(pos, alpha, beta, ply);
+    }
+
+    tt_hit_t hit;
+    move_t hash_move = 0;
+    if (tt_probe(pos->key, &hit)) {
+        hash_move = hit.move;
+        int score = score_from_tt(hit.score, ply);
+        if (ply > 0 && hit.depth >= depth &&
+            (hit.bound == TT_BOUND_EXACT ||
+             (hit.bound == TT_BOUND_LOWER && score >= beta) ||
+             (hit.bound == TT_BOUND_UPPER && score <= alpha))) {
+            return score;
+        }
+    }
+
+    move_list_t *list = &ply_moves[ply];
+    generate_legal_moves(pos, list);
+    if (list->count == 0) {
+        return checked ? -SCORE_MATE + ply : 0;
+    }
+    order_moves(pos, ply, hash_move);
+
+    int original_alpha = alpha;
+    int best_score = -SCORE_INFINITE;
+    move_t best_move = 0;
+    for (int i = 0; i < list->count; i++) {
+        move_t move = pick_move(ply, i);
+        make_move(pos, move);
+        int score;
+        if (i == 0) {
+            score = -alpha_beta(pos, depth - 1, -beta, -alpha, ply + 1);
+        } else {
+            // Null window first; search again only if the move might be better
+            score = -alpha_beta(pos, depth - 1, -alpha - 1, -alpha, ply + 1);
+            if (score > alpha && score < beta && !stopped) {
+                score = -alpha_beta(pos, depth - 1, -beta, -alpha, ply + 1);
+            }
+        }
+        unmake_move(pos);
+        if (stopped) {
+            return 0;
+        }
+
+        if (score > best_score) {
+            best_score = score;
+            best_move = move;
+        }
+        if (score > alpha) {
+            alpha = score;
+        }
+        if (alpha >= beta) {
+            if (!MOVE_IS_CAPTURE(move) && killers[ply][0] != move) {
+                killers[ply][1] = killers[ply][0];
+                killers[ply][0] = move;
+            }
+            break;
+        }
+    }
+
+    if (ply == 0) {
+        root_best_move = best_move;
+    }
+    tt_bound_t bound = (best_score >= beta) ? TT_BOUND_LOWER :
+                       (best_score > original_alpha) ? TT_BOUND_EXACT : TT_BOUND_UPPER;
+    tt_store(pos->key, best_move, score_to_tt(best_score, ply), depth, bound);
+    return best_score;
+}
+
+void search_hint(position_t *pos, int64_t budget_us, search_result_t *result) {
+    int64_t start_us = time_now_us();
+    deadline_us = start_us + budget_us;
+    stopped = false;
+    nodes = 0;
+    root_best_move = 0;
+    memset(killers, 0, sizeof(killers));
+    memset(result, 0, sizeof(*result));
+
+    tt_init();
+    tt_new_search();
+
+    move_list_t *root = &ply_moves[0];
+    generate_legal_moves(pos, root);
+    if (root->count == 0) {
+        result->score = in_check(pos) ? -SCORE_MATE : 0;
+        return;
+    }
+    // Something to show even if the first iteration cannot finish
+    result->best_move = root->moves[0];
+
+    for (int depth = 1; depth < SEARCH_MAX_PLY; depth++) {
+        int score = alpha_beta(pos, depth, -SCORE_INFINITE, SCORE_INFINITE, 0);
+        if (stopped) {
+            break;
+        }
+
+        // Never publish a move the root list does not have
+        if (!is_root_move(root_best_move)) {
+            break;
+        }
+        result->best_move = root_best_move;
+        result->score = score;
+        result->depth = depth;
+
+        if (score > SCORE_MATE - SEARCH_MAX_PLY || score < -SCORE_MATE + SEARCH_MAX_PLY ||
+            time_now_us() - start_us >= budget_us / SOFT_LIMIT_DIVISOR) {
+            break;
+        }
+    }
+
+    result->nodes = nodes;
+    result->elapsed_us = time_now_us() - start_us;
+    result->stopped = stopped;
+}
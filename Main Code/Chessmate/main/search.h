@@ -0,0 +1,45 @@
+// search.h
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "calculate_moves.h"
+
+// Plies the search can reach, including captures searched past the nominal depth
+#define SEARCH_MAX_PLY  32
+#define SCORE_MATE      30000
+#define SCORE_INFINITE  32000
+
+typedef struct {
+    move_t best_move;       // 0 if the side to move has no legal move
+    int score;              // centipawns from the side to move's point of view
+    int depth;              // deepest iteration that finished
+    uint32_t nodes;
+    int64_t elapsed_us;
+    bool stopped;           // cut short by the deadline or search_stop()
+} search_result_t;
+
+// Thinking time for a hint given the player's remaining clock in seconds.
+// Short time controls get quick hints, long ones get deeper hints.
+int64_t search_budget_us(int remaining_s);
+
+// Iterative-deepening alpha-beta search for the best move. Returns within
+// budget_us: the clock is checked while searching, and the best move of the
+// deepest finished iteration is kept. pos is used for make/unmake and is
+// restored before returning.
+void search_hint(position_t *pos, int64_t budget_us, search_result_t *result);
+
+// Asks a running search to return as soon as possible. Safe to call from any task.
+// The request stays set until search_arm(), so a stop that arrives before the
+// search starts is not lost.
+void search_stop(void);
+
+// Clears an earlier search_stop(). Call it before deciding to search, not
+// from inside search_hint(), or a stop sent in between would be overwritten.
+void search_arm(void);
+
+// Static evaluation in centipawns from the side to move's point of view
+int evaluate(const position_t *pos);
+
+#endif // SEARCH_H
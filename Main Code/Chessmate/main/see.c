@@ -0,0 +1,129 @@
+//Static exchange evaluation: which pieces can be won by capturing them
+#include <string.h>
+#include "see.h"
+
+// Knight and bishop are worth the same here so that trading one for the
+// other is not reported as losing material
+static const int see_values[6] = { 100, 300, 300, 500, 900, 20000 };
+
+// Longest possible capture sequence on one square is 32 pieces
+#define SEE_MAX_DEPTH 32
+
+static inline int max_int(int a, int b) {
+    return a > b ? a : b;
+}
+
+// Least valuable piece of color in attackers, or -1. Its type is written to *type.
+static int least_valuable(const position_t *pos, uint64_t attackers, piece_color_t color, piece_type_t *type) {
+    for (piece_type_t t = PAWN; t <= KING; t++) {
+        uint64_t bb = attackers & pos->pieces[color][t];
+        if (bb) {
+            *type = t;
+            return bb_lsb(bb);
+        }
+    }
+    return -1;
+}
+
+// Swap algorithm: plays out captures on sq with the least valuable attacker
+// each time, then lets each side stop where it is best off.
+// attackers are all pieces of both colors attacking sq with the full board.
+static int swap(const position_t *pos, int sq, uint64_t attackers) {
+    piece_color_t side = (piece_color_t)!PIECE_COLOR(pos->squares[sq]);
+    uint64_t occupied = pos->occupied;
+    uint64_t diagonal = pos->pieces[WHITE][BISHOP] | pos->pieces[BLACK][BISHOP]
+                      | pos->pieces[WHITE][QUEEN] | pos->pieces[BLACK][QUEEN];
+    uint64_t straight = pos->pieces[WHITE][ROOK] | pos->pieces[BLACK][ROOK]
+                      | pos->pieces[WHITE][QUEEN] | pos->pieces[BLACK][QUEEN];
+    int gain[SEE_MAX_DEPTH];
+    int depth = 0;
+    piece_type_t type;
+
+    int from = least_valuable(pos, attackers, side, &type);
+    if (from < 0) {
+        return 0;
+    }
+    gain[0] = see_values[PIECE_TYPE(pos->squares[sq])];
+
+    while (1) {
+        depth++;
+        // What the capturing side stands to lose if the piece that just
+        // captured is taken in turn
+        gain[depth] = see_values[type] - gain[depth - 1];
+        if (max_int(-gain[depth - 1], gain[depth]) < 0 || depth == SEE_MAX_DEPTH - 1) {
+            break;
+        }
+
+        // Taking the capturer off the board can uncover a slider behind it
+        occupied ^= SQUARE_BB(from);
+        attackers |= (bishop_attacks(sq, occupied) & diagonal) | (rook_attacks(sq, occupied) & straight);
+        attackers &= occupied;
+
+        side = (piece_color_t)!side;
+        from = least_valuable(pos, attackers, side, &type);
+        if (from < 0) {
+            break;
+        }
+        // A king cannot recapture onto a square that is still attacked
+        if (type == KING && (attackers & pos->by_color[!side])) {
+            break;
+        }
+    }
+
+    while (--depth) {
+        gain[depth - 1] = -max_int(-gain[depth - 1], gain[depth]);
+    }
+    return gain[0];
+}
+
+int see_threat(const position_t *pos, int sq) {
+    uint8_t piece = pos->squares[sq];
+    if (PIECE_TYPE(piece) == NO_PIECE || PIECE_TYPE(piece) == KING) {
+        return 0;
+    }
+    uint64_t attackers = attackers_to(pos, sq, pos->occupied);
+    return max_int(swap(pos, sq, attackers), 0);
+}
+
+uint64_t see_label_pieces(const position_t *pos, uint8_t labels[64]) {
+    // The swap only runs for pieces that are attacked at all. The live game
+    // keeps both sides' attack maps; other positions get them from scratch.
+    uint64_t counts[2][ATTACK_COUNT_BITS];
+    const uint64_t (*planes)[ATTACK_COUNT_BITS] = pos->attack_counts;
+    if (!pos->track_attacks) {
+        position_compute_attacks(pos, counts);
+        planes = (const uint64_t (*)[ATTACK_COUNT_BITS])counts;
+    }
+    uint64_t attacked[2] = { 0, 0 };
+    for (int i = 0; i < ATTACK_COUNT_BITS; i++) {
+        attacked[WHITE] |= planes[WHITE][i];
+        attacked[BLACK] |= planes[BLACK][i];
+    }
+    uint64_t at_risk = 0;
+
+    memset(labels, SEE_NONE, 64);
+    for (int color = WHITE; color <= BLACK; color++) {
+        uint64_t pieces = pos->by_color[color] & ~pos->pieces[color][KING];
+        uint64_t threatened = pieces & attacked[!color];
+
+        // Pieces the other side does not attack need no exchange
+        uint64_t safe = pieces & ~threatened;
+        while (safe) {
+            labels[bb_pop_lsb(&safe)] = SEE_SAFE;
+        }
+
+        while (threatened) {
+            int sq = bb_pop_lsb(&threatened);
+            if (!(attacked[color] & SQUARE_BB(sq))) {
+                labels[sq] = SEE_HANGING;
+            } else if (swap(pos, sq, attackers_to(pos, sq, pos->occupied)) > 0) {
+                labels[sq] = SEE_LOSING;
+            } else {
+                labels[sq] = SEE_DEFENDED;
+                continue;
+            }
+            at_risk |= SQUARE_BB(sq);
+        }
+    }
+    return at_risk;
+}
@@ -0,0 +1,29 @@
+// see.h
+#ifndef SEE_H
+#define SEE_H
+
+#include <stdint.h>
+#include "calculate_moves.h"
+
+// How safe a piece is, judged by its owner
+typedef enum {
+    SEE_NONE,       // empty square or a king
+    SEE_SAFE,       // not attacked
+    SEE_DEFENDED,   // attacked, but every exchange on the square breaks even or loses for the attacker
+    SEE_HANGING,    // attacked and not defended
+    SEE_LOSING      // defended, but the attacker still comes out ahead, e.g. a rook attacked by a pawn
+} see_label_t;
+
+// Material the opponent wins by starting a capture sequence on sq with its
+// least valuable attacker, in centipawns. 0 if the square is empty, holds a
+// king, or no capture sequence gains anything.
+// Both sides may stop capturing whenever that suits them, and a king only
+// recaptures onto a square the other side no longer attacks. Pins are not
+// taken into account.
+int see_threat(const position_t *pos, int sq);
+
+// Labels every piece on the board, both colors, in one pass. Returns a mask
+// of the pieces labelled SEE_HANGING or SEE_LOSING.
+uint64_t see_label_pieces(const position_t *pos, uint8_t labels[64]);
+
+#endif // SEE_H
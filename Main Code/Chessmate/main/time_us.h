@@ -0,0 +1,25 @@
+// time_us.h
+#ifndef TIME_US_H
+#define TIME_US_H
+
+#include <stdint.h>
+
+// Monotonic time in microseconds: esp_timer on the board, CLOCK_MONOTONIC in
+// the host build
+#ifdef ESP_PLATFORM
+#include "esp_timer.h"
+
+static inline int64_t time_now_us(void) {
+    return esp_timer_get_time();
+}
+#else
+#include <time.h>
+
+static inline int64_t time_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+#endif
+
+#endif // TIME_US_H
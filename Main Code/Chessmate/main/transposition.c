@@ -0,0 +1,161 @@
+//Transposition table shared by the assist search
+#include <stdlib.h>
+#include <string.h>
+#include "transposition.h"
+
+#if defined(ESP_PLATFORM) && defined(CONFIG_SPIRAM) && CONFIG_SPIRAM
+#include "esp_heap_caps.h"
+#endif
+
+// Each entry stores its data and the key XORed with that data. A reader on
+// the other core that sees half of a write gets a key that does not match and
+// treats it as a miss, so no lock is needed.
+typedef struct {
+    uint64_t check;     // key ^ data
+    uint64_t data;
+} tt_entry_t;
+
+typedef struct {
+    tt_entry_t entries[TT_BUCKET_SIZE];
+} tt_bucket_t;
+
+// data layout: move 0-15, score 16-31, depth 32-39, bound 40-41, generation 42-47,
+// valid 48. The valid bit keeps every stored entry non-zero, so data == 0
+// always means an empty slot, even for a null move with score, depth and
+// generation 0.
+#define DATA_VALID          (1ULL << 48)
+#define DATA_MOVE(d)        ((move_t)((d) & 0xFFFF))
+#define DATA_SCORE(d)       ((int16_t)(((d) >> 16) & 0xFFFF))
+#define DATA_DEPTH(d)       ((int8_t)(((d) >> 32) & 0xFF))
+#define DATA_BOUND(d)       ((tt_bound_t)(((d) >> 40) & 0x3))
+#define DATA_GENERATION(d)  ((uint8_t)(((d) >> 42) & 0x3F))
+#define GENERATION_MASK     0x3F
+
+#define FILL_SAMPLE_BUCKETS 250
+
+static tt_bucket_t *table;
+static size_t bucket_count;
+static uint8_t generation;
+static tt_stats_t stats;
+
+bool tt_init(void) {
+    if (table != NULL) {
+        return true;
+    }
+    bucket_count = ((size_t)TT_SIZE_KB * 1024) / sizeof(tt_bucket_t);
+#if defined(ESP_PLATFORM) && defined(CONFIG_SPIRAM) && CONFIG_SPIRAM
+    table = heap_caps_malloc(bucket_count * sizeof(tt_bucket_t), MALLOC_CAP_SPIRAM);
+#else
+    table = malloc(bucket_count * sizeof(tt_bucket_t));
+#endif
+    if (table == NULL) {
+        bucket_count = 0;
+        return false;
+    }
+    tt_clear();
+    return true;
+}
+
+void tt_clear(void) {
+    if (table != NULL) {
+        memset(table, 0, bucket_count * sizeof(tt_bucket_t));
+    }
+    generation = 0;
+    memset(&stats, 0, sizeof(stats));
+}
+
+void tt_new_search(void) {
+    generation = (generation + 1) & GENERATION_MASK;
+}
+
+// Maps the upper key bits onto the bucket range without needing a power of two
+static inline tt_bucket_t *bucket_for(uint64_t key) {
+    return &table[(size_t)(((key >> 32) * (uint64_t)bucket_count) >> 32)];
+}
+
+bool tt_probe(uint64_t key, tt_hit_t *hit) {
+    if (table == NULL) {
+        return false;
+    }
+    stats.probes++;
+
+    tt_bucket_t *bucket = bucket_for(key);
+    for (int i = 0; i < TT_BUCKET_SIZE; i++) {
+        uint64_t data = bucket->entries[i].data;
+        uint64_t check = bucket->entries[i].check;
+        if (data != 0 && (check ^ data) == key) {
+            hit->move = DATA_MOVE(data);
+            hit->score = DATA_SCORE(data);
+            hit->depth = DATA_DEPTH(data);
+            hit->bound = DATA_BOUND(data);
+            stats.hits++;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Entries from older searches count for less, so deep results from a previous
+// move do not crowd out the current search forever
+static inline int replace_value(uint64_t data) {
+    int age = (generation - DATA_GENERATION(data)) & GENERATION_MASK;
+    return DATA_DEPTH(data) - 8 * age;
+}
+
+void tt_store(uint64_t key, move_t move, int score, int depth, tt_bound_t bound) {
+    if (table == NULL) {
+        return;
+    }
+
+    tt_bucket_t *bucket = bucket_for(key);
+    tt_entry_t *victim = &bucket->entries[0];
+    for (int i = 0; i < TT_BUCKET_SIZE; i++) {
+        tt_entry_t *entry = &bucket->entries[i];
+        uint64_t data = entry->data;
+        if (data == 0 || (entry->check ^ data) == key) {
+            // Keep the old best move if this result has none
+            if (data != 0 && move == 0) {
+                move = DATA_MOVE(data);
+            }
+            victim = entry;
+            break;
+        }
+        if (replace_value(data) < replace_value(victim->data)) {
+            victim = entry;
+        }
+    }
+
+    uint64_t old = victim->data;
+    if (old != 0 && (victim->check ^ old) != key && DATA_GENERATION(old) == generation) {
+        stats.collisions++;
+    }
+
+    uint64_t data = (uint64_t)move |
+                    ((uint64_t)(uint16_t)score << 16) |
+                    ((uint64_t)(uint8_t)depth << 32) |
+                    ((uint64_t)bound << 40) |
+                    ((uint64_t)generation << 42) |
+                    DATA_VALID;
+    victim->data = data;
+    victim->check = key ^ data;
+    stats.stores++;
+}
+
+void tt_get_stats(tt_stats_t *out) {
+    *out = stats;
+    out->bytes = bucket_count * sizeof(tt_bucket_t);
+    out->entries = bucket_count * TT_BUCKET_SIZE;
+
+    // Sample the start of the table like the UCI hashfull figure
+    size_t sample = bucket_count < FILL_SAMPLE_BUCKETS ? bucket_count : FILL_SAMPLE_BUCKETS;
+    uint32_t used = 0;
+    for (size_t b = 0; b < sample; b++) {
+        for (int i = 0; i < TT_BUCKET_SIZE; i++) {
+            uint64_t data = table[b].entries[i].data;
+            if (data != 0 && DATA_GENERATION(data) == generation) {
+                used++;
+            }
+        }
+    }
+    out->fill_permille = sample ? (uint32_t)(used * 1000 / (sample * TT_BUCKET_SIZE)) : 0;
+}
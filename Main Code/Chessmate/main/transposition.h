@@ -0,0 +1,74 @@
+// transposition.h
+#ifndef TRANSPOSITION_H
+#define TRANSPOSITION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "calculate_moves.h"
+
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#endif
+
+// Memory budget for the table in KB. Boards with PSRAM get a larger table
+// there; others keep a small one in internal RAM. Set per board build in
+// menuconfig, or with -DTT_SIZE_KB=<kb> on the host.
+#ifndef TT_SIZE_KB
+#if defined(CONFIG_CHESSMATE_TT_SIZE_KB)
+#define TT_SIZE_KB CONFIG_CHESSMATE_TT_SIZE_KB
+#elif defined(CONFIG_SPIRAM) && CONFIG_SPIRAM
+#define TT_SIZE_KB 1024
+#else
+#define TT_SIZE_KB 32
+#endif
+#endif
+
+// Entries per bucket. A store replaces the least useful entry in its bucket.
+#ifndef TT_BUCKET_SIZE
+#if defined(CONFIG_CHESSMATE_TT_BUCKET_SIZE)
+#define TT_BUCKET_SIZE CONFIG_CHESSMATE_TT_BUCKET_SIZE
+#else
+#define TT_BUCKET_SIZE 4
+#endif
+#endif
+
+typedef enum {
+    TT_BOUND_NONE,
+    TT_BOUND_UPPER,     // score is at most the stored value
+    TT_BOUND_LOWER,     // score is at least the stored value
+    TT_BOUND_EXACT
+} tt_bound_t;
+
+typedef struct {
+    move_t move;
+    int16_t score;
+    int8_t depth;
+    tt_bound_t bound;
+} tt_hit_t;
+
+typedef struct {
+    uint32_t probes;
+    uint32_t hits;
+    uint32_t stores;
+    uint32_t collisions;    // stores that evicted another position from this search
+    uint32_t fill_permille; // share of sampled entries written by this search
+    size_t bytes;
+    size_t entries;
+} tt_stats_t;
+
+// Allocates the table. Returns false if the memory is not available.
+bool tt_init(void);
+void tt_clear(void);
+
+// Call at the start of each search so entries from older searches age out
+void tt_new_search(void);
+
+bool tt_probe(uint64_t key, tt_hit_t *hit);
+void tt_store(uint64_t key, move_t move, int score, int depth, tt_bound_t bound);
+
+// Counters since the last tt_clear(). They are not atomic, so they are only
+// approximate while a second core is searching.
+void tt_get_stats(tt_stats_t *stats);
+
+#endif // TRANSPOSITION_H
@@ -0,0 +1,21 @@
+# Build-time generation of the const lookup tables, shared by the firmware and host builds.
+set(CHESSMATE_TOOLS_DIR ${CMAKE_CURRENT_LIST_DIR})
+
+# Adds a chess_tables target that writes attack_tables.h and zobrist_keys.h into out_dir
+function(chessmate_tables python out_dir)
+    set(attack_script ${CHESSMATE_TOOLS_DIR}/gen_attack_tables.py)
+    set(zobrist_script ${CHESSMATE_TOOLS_DIR}/gen_zobrist_keys.py)
+    add_custom_command(
+        OUTPUT ${out_dir}/attack_tables.h
+        COMMAND ${python} ${attack_script} ${out_dir}/attack_tables.h
+        DEPENDS ${attack_script}
+        COMMENT "Generating attack_tables.h"
+    )
+    add_custom_command(
+        OUTPUT ${out_dir}/zobrist_keys.h
+        COMMAND ${python} ${zobrist_script} ${out_dir}/zobrist_keys.h
+        DEPENDS ${zobrist_script}
+        COMMENT "Generating zobrist_keys.h"
+    )
+    add_custom_target(chess_tables DEPENDS ${out_dir}/attack_tables.h ${out_dir}/zobrist_keys.h)
+endfunction()
@@ -0,0 +1,166 @@
+## Generates attack_tables.h for calculate_moves.c at build time.
+## Every table is emitted as const data so it is placed in flash on the ESP32
+## and nothing has to be computed at startup.
+##
+## Sliding pieces use kindergarten-style multiply indexing: the occupancy of the
+## six inner squares of a rank, file or diagonal is gathered into a 6 bit index
+## with one mask, one multiply and one shift (a software PEXT), and the index
+## selects a precomputed attack set. The tables are about 12 KB in total, small
+## enough to stay in the flash cache, where full-board magic tables for rooks
+## would need around 800 KB.
+import sys
+
+MASK64 = (1 << 64) - 1
+A_FILE = 0x0101010101010101
+B_FILE = 0x0202020202020202
+DIAG_C7_B2 = 0x0004081020408000
+
+KING_STEPS = [(1, 1), (1, 0), (1, -1), (0, 1), (0, -1), (-1, 1), (-1, 0), (-1, -1)]
+KNIGHT_STEPS = [(2, 1), (2, -1), (-2, 1), (-2, -1), (1, 2), (-1, 2), (1, -2), (-1, -2)]
+
+def on_board(row, col):
+    return 0 <= row <= 7 and 0 <= col <= 7
+
+def bit(row, col):
+    return 1 << (row * 8 + col)
+
+def step_table(steps):
+    table = []
+    for sq in range(64):
+        row, col = divmod(sq, 8)
+        bb = 0
+        for dr, dc in steps:
+            if on_board(row + dr, col + dc):
+                bb |= bit(row + dr, col + dc)
+        table.append(bb)
+    return table
+
+def pawn_table(forward):
+    table = []
+    for sq in range(64):
+        row, col = divmod(sq, 8)
+        bb = 0
+        for dc in (-1, 1):
+            if on_board(row + forward, col + dc):
+                bb |= bit(row + forward, col + dc)
+        table.append(bb)
+    return table
+
+def ray_attacks(sq, occupied, dirs):
+    row, col = divmod(sq, 8)
+    bb = 0
+    for dr, dc in dirs:
+        r, c = row + dr, col + dc
+        while on_board(r, c):
+            bb |= bit(r, c)
+            if occupied & bit(r, c):
+                break
+            r, c = r + dr, c + dc
+    return bb
+
+def line_mask(sq, dirs):
+    return ray_attacks(sq, 0, dirs)
+
+def inner_occupancies(squares):
+    ## every subset of the inner squares of a line (the two end squares never block)
+    for pattern in range(64):
+        occ = 0
+        for i in range(6):
+            if pattern & (1 << i):
+                occ |= 1 << squares[i + 1]
+        yield occ
+
+def fill_index(line, occupied):
+    return (((line & occupied) * B_FILE) & MASK64) >> 58
+
+def file_index(col, occupied):
+    return (((A_FILE & (occupied >> col)) * DIAG_C7_B2) & MASK64) >> 58
+
+def store(table, index, value):
+    if table[index] is not None and table[index] != value:
+        sys.exit("gen_attack_tables: index collision")
+    table[index] = value
+
+def unused_to_zero(table):
+    ## indices that need the slider's own square to be occupied can never occur
+    return [v if v is not None else 0 for v in table]
+
+def main():
+    out_path = sys.argv[1]
+    rank_dirs = [(0, 1), (0, -1)]
+    diag_dirs = [(1, 1), (-1, -1)]
+    anti_dirs = [(1, -1), (-1, 1)]
+    file_dirs = [(1, 0), (-1, 0)]
+
+    rank_mask = [line_mask(sq, rank_dirs) for sq in range(64)]
+    diag_mask = [line_mask(sq, diag_dirs) for sq in range(64)]
+    anti_mask = [line_mask(sq, anti_dirs) for sq in range(64)]
+
+    ## fill_up[col][index]: rank attacks of a slider on this column, copied to all
+    ## eight rows so one table serves ranks and both diagonals
+    fill_up = []
+    for col in range(8):
+        table = [None] * 64
+        for occ in inner_occupancies(list(range(8))):
+            attacks = ray_attacks(col, occ, rank_dirs)
+            store(table, fill_index(rank_mask[col], occ), (attacks * A_FILE) & MASK64)
+        fill_up.append(unused_to_zero(table))
+
+    ## a_file[row][index]: attacks of a slider on the A file
+    a_file = []
+    for row in range(8):
+        table = [None] * 64
+        for occ in inner_occupancies([r * 8 for r in range(8)]):
+            store(table, file_index(0, occ), ray_attacks(row * 8, occ, file_dirs))
+        a_file.append(unused_to_zero(table))
+
+    ## double check every line direction from every square against ray walking
+    for sq in range(64):
+        row, col = divmod(sq, 8)
+        for dirs, line in ((rank_dirs, rank_mask[sq]), (diag_dirs, diag_mask[sq]), (anti_dirs, anti_mask[sq])):
+            squares = sorted(s for s in range(64) if line & (1 << s))
+            for pattern in range(1 << len(squares)):
+                occ = sum(1 << squares[i] for i in range(len(squares)) if pattern & (1 << i))
+                if line & fill_up[col][fill_index(line, occ)] != ray_attacks(sq, occ, dirs):
+                    sys.exit("gen_attack_tables: bad line attacks on square %d" % sq)
+        for pattern in range(128):
+            occ = sum(1 << (r * 8 + col) for r in range(8) if r != row and pattern & (1 << (r if r < row else r - 1)))
+            if a_file[row][file_index(col, occ)] << col != ray_attacks(sq, occ, file_dirs):
+                sys.exit("gen_attack_tables: bad file attacks on square %d" % sq)
+
+    def emit_rows(f, values, indent, per_line=4):
+        for i in range(0, len(values), per_line):
+            f.write(indent + ", ".join("0x%016xULL" % v for v in values[i:i + per_line]) + ",\n")
+
+    def emit(f, name, values):
+        f.write("static const uint64_t %s = {\n" % name)
+        emit_rows(f, values, "    ")
+        f.write("};\n\n")
+
+    def emit_2d(f, name, tables):
+        f.write("static const uint64_t %s = {\n" % name)
+        for table in tables:
+            f.write("    {\n")
+            emit_rows(f, table, "        ")
+            f.write("    },\n")
+        f.write("};\n\n")
+
+    with open(out_path, "w") as f:
+        f.write("// attack_tables.h\n")
+        f.write("// Generated by tools/gen_attack_tables.py. Do not edit.\n")
+        f.write("#ifndef ATTACK_TABLES_H\n#define ATTACK_TABLES_H\n\n#include <stdint.h>\n\n")
+        f.write("#define ATTACK_A_FILE     0x%016xULL\n" % A_FILE)
+        f.write("#define ATTACK_B_FILE     0x%016xULL\n" % B_FILE)
+        f.write("#define ATTACK_DIAG_C7_B2 0x%016xULL\n\n" % DIAG_C7_B2)
+        emit(f, "KNIGHT_ATTACKS[64]", step_table(KNIGHT_STEPS))
+        emit(f, "KING_ATTACKS[64]", step_table(KING_STEPS))
+        emit_2d(f, "PAWN_ATTACKS[2][64]", [pawn_table(1), pawn_table(-1)])
+        emit(f, "RANK_MASK[64]", rank_mask)
+        emit(f, "DIAG_MASK[64]", diag_mask)
+        emit(f, "ANTI_DIAG_MASK[64]", anti_mask)
+        emit_2d(f, "FILL_UP_ATTACKS[8][64]", fill_up)
+        emit_2d(f, "A_FILE_ATTACKS[8][64]", a_file)
+        f.write("#endif // ATTACK_TABLES_H\n")
+
+if __name__ == "__main__":
+    main()
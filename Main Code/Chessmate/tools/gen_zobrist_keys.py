@@ -0,0 +1,47 @@
+## Generates zobrist_keys.h for calculate_moves.c at build time.
+## A position's key is the XOR of one random 64 bit number per piece on each
+## square, plus the castling rights, the en passant file and the side to move,
+## so make_move and unmake_move can update it with a few XORs.
+## The seed is fixed so every build (and every board) uses the same keys.
+import random
+import sys
+
+def main():
+    rng = random.Random(0x43686573734D617465)  ## "ChessMate"
+    key = lambda: rng.getrandbits(64)
+
+    pieces = [[[key() for sq in range(64)] for piece in range(6)] for color in range(2)]
+    castling = [0] + [key() for rights in range(1, 16)]
+    en_passant = [key() for col in range(8)]
+    side = key()
+
+    def row(values):
+        return ", ".join("0x%016xULL" % v for v in values)
+
+    with open(sys.argv[1], "w") as f:
+        f.write("// zobrist_keys.h\n")
+        f.write("// Generated by tools/gen_zobrist_keys.py. Do not edit.\n")
+        f.write("#ifndef ZOBRIST_KEYS_H\n#define ZOBRIST_KEYS_H\n\n#include <stdint.h>\n\n")
+        f.write("#define ZOBRIST_SIDE 0x%016xULL\n\n" % side)
+        f.write("static const uint64_t ZOBRIST_PIECES[2][6][64] = {\n")
+        for color in pieces:
+            f.write("    {\n")
+            for piece in color:
+                f.write("        {\n")
+                for i in range(0, 64, 4):
+                    f.write("            " + row(piece[i:i + 4]) + ",\n")
+                f.write("        },\n")
+            f.write("    },\n")
+        f.write("};\n\n")
+        f.write("static const uint64_t ZOBRIST_CASTLING[16] = {\n")
+        for i in range(0, 16, 4):
+            f.write("    " + row(castling[i:i + 4]) + ",\n")
+        f.write("};\n\n")
+        f.write("static const uint64_t ZOBRIST_EN_PASSANT[8] = {\n")
+        for i in range(0, 8, 4):
+            f.write("    " + row(en_passant[i:i + 4]) + ",\n")
+        f.write("};\n\n")
+        f.write("#endif // ZOBRIST_KEYS_H\n")
+
+if __name__ == "__main__":
+    main()
@@ -1,9 +1,16 @@
 #include "lvgl_demo_ui.h"
 #include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
 
 static const char *TAG = "lvgl_demo_ui";
 
+// Labels for the menu are created once and reused; no menu has more items
+#define MENU_POOL_SIZE 8
+#define MENU_ITEM_COLOR      lv_color_make(255, 255, 255)
+#define MENU_SELECTED_COLOR  lv_color_make(255, 0, 0)
+
 static lv_obj_t *main_screen;
 static lv_obj_t *menu_cont;
 static lv_obj_t *timer1_label;
@@ -12,6 +19,17 @@ static lv_obj_t *msg_label;
 static lv_timer_t *msg_timer = NULL;
 static lv_style_t style_msg_bg;
 
+// LVGL is not thread-safe. The main loop runs lv_timer_handler() and the
+// button, timer and game tasks update widgets, so all of it holds this lock.
+// Recursive, so LVGL timer callbacks can call the update functions.
+static SemaphoreHandle_t lvgl_mutex;
+
+// What the menu labels show right now, so update_menu() only touches what changed
+static lv_obj_t *menu_labels[MENU_POOL_SIZE];
+static const char *menu_texts[MENU_POOL_SIZE];
+static int menu_count;
+static int menu_selected = -1;
+
 // Timer callback for message hiding
 static void msg_timer_cb(lv_timer_t *timer)
 {
@@ -28,8 +46,21 @@ static void msg_timer_cb(lv_timer_t *timer)
     }
 }
 
+void lvgl_lock(void)
+{
+    xSemaphoreTakeRecursive(lvgl_mutex, portMAX_DELAY);
+}
+
+void lvgl_unlock(void)
+{
+    xSemaphoreGiveRecursive(lvgl_mutex);
+}
+
 void example_lvgl_demo_ui(lv_disp_t *disp)
 {
+    lvgl_mutex = xSemaphoreCreateRecursiveMutex();
+    lvgl_lock();
+
     // Get the current screen
     main_screen = lv_disp_get_scr_act(disp);
     
@@ -47,6 +78,20 @@ void example_lvgl_demo_ui(lv_disp_t *disp)
     lv_obj_set_style_pad_all(menu_cont, 15, 0);
     lv_obj_clear_flag(menu_cont, LV_OBJ_FLAG_SCROLLABLE);
 
+    // Menu label pool, created before the message box so messages stay on top
+    for (int i = 0; i < MENU_POOL_SIZE; i++) {
+        lv_obj_t *item = lv_label_create(menu_cont);
+        lv_obj_set_width(item, lv_pct(90));  // Set width to 90% of container
+        // Position label - increased vertical spacing for better readability
+        lv_obj_align(item, LV_ALIGN_TOP_LEFT, 20, 20 + i * 40);
+        lv_obj_set_style_text_font(item, &lv_font_montserrat_14, 0);
+        lv_obj_set_style_text_opa(item, LV_OPA_COVER, 0);
+        lv_obj_set_style_text_color(item, MENU_ITEM_COLOR, 0);
+        lv_label_set_text_static(item, "");
+        lv_obj_add_flag(item, LV_OBJ_FLAG_HIDDEN);
+        menu_labels[i] = item;
+    }
+
     // Create right side container (35% of screen width)
     lv_obj_t *right_cont = lv_obj_create(main_screen);
     lv_obj_set_size(right_cont, lv_pct(35), lv_pct(100));
@@ -96,42 +141,51 @@ void example_lvgl_demo_ui(lv_disp_t *disp)
     lv_label_set_long_mode(msg_label, LV_LABEL_LONG_WRAP);
     lv_obj_center(msg_label);
     lv_obj_add_flag(msg_label, LV_OBJ_FLAG_HIDDEN);
+    lvgl_unlock();
 }
 
+// Items must be strings that outlive the menu (the MenuItem names), since the
+// labels keep pointing at them instead of copying
 void update_menu(const char **items, int item_count, int selected_index)
 {
-    ESP_LOGI(TAG, "Updating menu with %d items, selected: %d", item_count, selected_index);
-    
-    // Clear existing menu items
-    lv_obj_clean(menu_cont);
-    
-    // Create new menu items
-    for (int i = 0; i < item_count; i++) {
-        lv_obj_t *item = lv_label_create(menu_cont);
-        
-        // Configure label
-        lv_label_set_text(item, items[i]);
-        lv_obj_set_width(item, lv_pct(90));  // Set width to 90% of container
-        
-        // Position label - increased vertical spacing for better readability
-        lv_obj_align(item, LV_ALIGN_TOP_LEFT, 20, 20 + i * 40);
-        
-        // Set text style
-        lv_obj_set_style_text_font(item, &lv_font_montserrat_14, 0);
-        lv_obj_set_style_text_opa(item, LV_OPA_COVER, 0);
-        
-        // Set color based on selection
-        if (i == selected_index) {
-            lv_obj_set_style_text_color(item, lv_color_make(255, 0, 0), 0);  // Red for selected
+    if (item_count > MENU_POOL_SIZE) {
+        ESP_LOGW(TAG, "Menu has %d items, showing the first %d", item_count, MENU_POOL_SIZE);
+        item_count = MENU_POOL_SIZE;
+    }
+    lvgl_lock();
+
+    // A new menu level: set the labels whose text differs and show or hide the rest
+    bool level_changed = item_count != menu_count;
+    for (int i = 0; i < MENU_POOL_SIZE; i++) {
+        const char *text = (i < item_count) ? items[i] : NULL;
+        if (text == menu_texts[i]) {
+            continue;
+        }
+        level_changed = true;
+        if (text) {
+            lv_label_set_text_static(menu_labels[i], text);
+            lv_obj_clear_flag(menu_labels[i], LV_OBJ_FLAG_HIDDEN);
         } else {
-            lv_obj_set_style_text_color(item, lv_color_make(255, 255, 255), 0);  // White for others
+            lv_obj_add_flag(menu_labels[i], LV_OBJ_FLAG_HIDDEN);
         }
-        
-        ESP_LOGI(TAG, "Created menu item: %s", items[i]);
+        menu_texts[i] = text;
     }
-    
-    // Force an immediate refresh
-    lv_refr_now(NULL);
+    menu_count = item_count;
+    if (level_changed) {
+        ESP_LOGI(TAG, "Menu now has %d items, selected: %d", item_count, selected_index);
+    }
+
+    // A selection move restyles only the two labels involved
+    if (selected_index != menu_selected) {
+        if (menu_selected >= 0 && menu_selected < MENU_POOL_SIZE) {
+            lv_obj_set_style_text_color(menu_labels[menu_selected], MENU_ITEM_COLOR, 0);
+        }
+        if (selected_index >= 0 && selected_index < MENU_POOL_SIZE) {
+            lv_obj_set_style_text_color(menu_labels[selected_index], MENU_SELECTED_COLOR, 0);
+        }
+        menu_selected = selected_index;
+    }
+    lvgl_unlock();
 }
 
 void update_timers(int player1_time, int player2_time, int active_player)
@@ -140,6 +194,7 @@ void update_timers(int player1_time, int player2_time, int active_player)
     snprintf(timer1_text, sizeof(timer1_text), "P1: %02d:%02d", player1_time / 60, player1_time % 60);
     snprintf(timer2_text, sizeof(timer2_text), "P2: %02d:%02d", player2_time / 60, player2_time % 60);
     
+    lvgl_lock();
     lv_label_set_text(timer1_label, timer1_text);
     lv_label_set_text(timer2_label, timer2_text);
 
@@ -148,10 +203,12 @@ void update_timers(int player1_time, int player2_time, int active_player)
         active_player == 1 ? lv_color_make(255, 0, 0) : lv_color_make(255, 255, 255), 0);
     lv_obj_set_style_text_color(timer2_label, 
         active_player == 2 ? lv_color_make(255, 0, 0) : lv_color_make(255, 255, 255), 0);
+    lvgl_unlock();
 }
 
 void display_message(const char *message)
 {
+    lvgl_lock();
     // Get message background (parent of msg_label)
     lv_obj_t *msg_bg = lv_obj_get_parent(msg_label);
     
@@ -174,4 +231,5 @@ void display_message(const char *message)
     
     // Create new timer to hide the message after 3 seconds
     msg_timer = lv_timer_create(msg_timer_cb, 3000, msg_bg);
+    lvgl_unlock();
 }
@@ -10,6 +10,9 @@ extern "C" {
 
 // Function declarations
 void example_lvgl_demo_ui(lv_disp_t *disp);
+// Held around every LVGL call; the update functions below take it themselves
+void lvgl_lock(void);
+void lvgl_unlock(void);
 void update_menu(const char **items, int item_count, int selected_index);
 void update_timers(int player1_time, int player2_time, int active_player);
 void display_message(const char *message);
@@ -1,6 +1,8 @@
 
 // menu_data.c
+#include <stdio.h>
 #include "menu_data.h"
+#include "led_display.h"
 #include "esp_log.h"
 
 static const char *TAG = "menu_data";
@@ -101,6 +103,8 @@ void set_assist_low(void) {
     display_message("Assist Level: Low");
 }
 
+// The hint search runs on the board firmware, which has no menu; there it is
+// turned on with CONFIG_CHESSMATE_ASSIST_HIGH
 void set_assist_high(void) {
     ESP_LOGI(TAG, "Assist Level: High");
     display_message("Assist Level: High");
@@ -108,16 +112,19 @@ void set_assist_high(void) {
 
 void set_brightness_low(void) {
     ESP_LOGI(TAG, "Brightness: Low");
+    led_set_brightness(LED_BRIGHTNESS_LOW);
     display_message("Brightness: Low");
 }
 
 void set_brightness_med(void) {
     ESP_LOGI(TAG, "Brightness: Medium");
+    led_set_brightness(LED_BRIGHTNESS_MED);
     display_message("Brightness: Medium");
 }
 
 void set_brightness_high(void) {
     ESP_LOGI(TAG, "Brightness: High");
+    led_set_brightness(LED_BRIGHTNESS_HIGH);
     display_message("Brightness: High");
 }
 
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_system.h"
@@ -14,6 +15,10 @@
 #include "menu_data.h"
 #include "esp_lcd_ili9341.h"
 #include "lvgl_demo_ui.h"
+#include "led_display.h"
+#if CONFIG_CHESSMATE_ENGINE_BENCH
+#include "engine_bench.h"
+#endif
 
 #define MAX_MENU_DEPTH 5
 #define LCD_PIXEL_CLOCK_HZ     (20 * 1000 * 1000)
@@ -38,6 +43,9 @@
 #define LCD_V_RES              240
 #define LCD_HOST              SPI2_HOST
 
+#define LVGL_TICK_PERIOD_MS    2
+#define LCD_STATS_PERIOD_MS    10000
+
 static const char *TAG = "example";
 
 // Global variables for menu state
@@ -53,11 +61,39 @@ static struct {
 } menu_stack[MAX_MENU_DEPTH];
 static int menu_stack_top = -1;
 
+// Display refresh counters. LVGL's refresh timer only draws when something was
+// invalidated, so a tick either renders a frame or is skipped without touching SPI.
+// The transfer times come from the transfer-done interrupt, hence the lock.
+static portMUX_TYPE lcd_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+typedef struct {
+    uint32_t rendered;
+    uint32_t skipped;
+    uint32_t flushes;
+    uint32_t flushed_bytes;
+    uint32_t frames_timed;      // frames whose last transfer has finished
+    uint64_t frame_us;          // start of rendering to the end of the last transfer
+    uint64_t render_us;         // LVGL drawing, without the waits for a free buffer
+    uint64_t transfer_us;       // time on the SPI bus
+    uint32_t max_frame_us;
+} lcd_stats_t;
+static lcd_stats_t lcd_stats;
+
+// The frame being drawn. LVGL has at most one flush on the wire at a time.
+static int64_t frame_start_us;
+static int64_t frame_wait_us;
+static int64_t wait_start_us;       // 0 unless LVGL is waiting for the other buffer
+static int64_t flush_start_us;
+static bool flush_last;
+
 // Function prototypes
 void example_lvgl_demo_ui(lv_disp_t *disp);
 void update_menu(const char **items, int item_count, int selected_index);
 void update_timers(int player1_time, int player2_time, int active_player);
 static void lvgl_flush_cb(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map);
+static void lvgl_refr_timer_cb(lv_timer_t *timer);
+static void lvgl_wait_cb(lv_disp_drv_t *drv);
+static bool lvgl_flush_done_cb(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_io_event_data_t *edata, void *user_ctx);
+static void lvgl_tick_cb(void *arg);
 static void button_task(void *pvParameter);
 static void timer_task(void *pvParameter);
 
@@ -155,6 +191,8 @@ static void button_task(void *pvParameter) {
         bool current_up_state = gpio_get_level(PIN_BUTTON_UP);
         bool current_down_state = gpio_get_level(PIN_BUTTON_DOWN);
         bool current_select_state = gpio_get_level(PIN_BUTTON_SELECT);
+        // The player buttons are the only way to switch the clock: this image
+        // has no scanner, so it cannot see a move finish on the board
         bool current_player1_state = gpio_get_level(PIN_BUTTON_PLAYER1);
         bool current_player2_state = gpio_get_level(PIN_BUTTON_PLAYER2);
 
@@ -244,8 +282,94 @@ static void lvgl_flush_cb(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t
     int offsetx2 = area->x2;
     int offsety1 = area->y1;
     int offsety2 = area->y2;
+
+    int64_t now_us = esp_timer_get_time();
+    if (wait_start_us) {
+        frame_wait_us += now_us - wait_start_us;
+        wait_start_us = 0;
+    }
+    lcd_stats.flushes++;
+    lcd_stats.flushed_bytes += (offsetx2 - offsetx1 + 1) * (offsety2 - offsety1 + 1) * sizeof(lv_color_t);
+
+    // Set before queueing, since the transfer can finish before draw_bitmap returns.
+    // LVGL is told the buffer is free from lvgl_flush_done_cb, and meanwhile
+    // renders the next area into the other buffer.
+    flush_last = lv_disp_flush_is_last(drv);
+    flush_start_us = now_us;
     esp_lcd_panel_draw_bitmap(panel_handle, offsetx1, offsety1, offsetx2 + 1, offsety2 + 1, color_map);
-    lv_disp_flush_ready(drv);
+}
+
+// Transfer-done callback of the panel IO, in interrupt context
+static bool lvgl_flush_done_cb(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_io_event_data_t *edata, void *user_ctx) {
+    lv_disp_drv_t *disp_drv = (lv_disp_drv_t *)user_ctx;
+    int64_t now_us = esp_timer_get_time();
+    portENTER_CRITICAL_ISR(&lcd_stats_lock);
+    lcd_stats.transfer_us += now_us - flush_start_us;
+    if (flush_last) {
+        uint32_t frame_us = now_us - frame_start_us;
+        lcd_stats.frames_timed++;
+        lcd_stats.frame_us += frame_us;
+        if (frame_us > lcd_stats.max_frame_us) {
+            lcd_stats.max_frame_us = frame_us;
+        }
+    }
+    portEXIT_CRITICAL_ISR(&lcd_stats_lock);
+    lv_disp_flush_ready(disp_drv);
+    return false;
+}
+
+// LVGL spins on this while both buffers are busy; the first call starts the wait
+static void lvgl_wait_cb(lv_disp_drv_t *drv) {
+    if (wait_start_us == 0) {
+        wait_start_us = esp_timer_get_time();
+    }
+}
+
+// Stands in for LVGL's refresh timer callback to count the ticks with nothing to draw
+static void lvgl_refr_timer_cb(lv_timer_t *timer) {
+    lv_disp_t *disp = timer->user_data;
+    if (disp->inv_p == 0) {
+        lcd_stats.skipped++;
+        _lv_disp_refr_timer(timer);
+        return;
+    }
+    lcd_stats.rendered++;
+    frame_start_us = esp_timer_get_time();
+    frame_wait_us = 0;
+    _lv_disp_refr_timer(timer);
+    lcd_stats.render_us += esp_timer_get_time() - frame_start_us - frame_wait_us;
+}
+
+static void lvgl_tick_cb(void *arg) {
+    lv_tick_inc(LVGL_TICK_PERIOD_MS);
+}
+
+// Logs the refresh counters for the last period; an idle menu should show no
+// flushes. With the transfers overlapping the rendering a frame takes less than
+// its render and SPI time added up, and the difference is logged as overlap.
+static void log_lcd_stats(void) {
+    static uint32_t last_tick = 0;
+    if (lv_tick_elaps(last_tick) < LCD_STATS_PERIOD_MS) {
+        return;
+    }
+    last_tick = lv_tick_get();
+
+    portENTER_CRITICAL(&lcd_stats_lock);
+    lcd_stats_t stats = lcd_stats;
+    memset(&lcd_stats, 0, sizeof(lcd_stats));
+    portEXIT_CRITICAL(&lcd_stats_lock);
+
+    ESP_LOGI(TAG, "LCD: %lu frames rendered, %lu refreshes skipped, %lu flushes (%lu bytes)",
+             (unsigned long)stats.rendered, (unsigned long)stats.skipped,
+             (unsigned long)stats.flushes, (unsigned long)stats.flushed_bytes);
+    if (stats.rendered && stats.frames_timed) {
+        long frame_us = stats.frame_us / stats.frames_timed;
+        long render_us = stats.render_us / stats.rendered;
+        long transfer_us = stats.transfer_us / stats.frames_timed;
+        ESP_LOGI(TAG, "LCD frame avg %ld us (max %lu): render %ld us, SPI %ld us, overlapped %ld us",
+                 frame_us, (unsigned long)stats.max_frame_us, render_us, transfer_us,
+                 render_us + transfer_us - frame_us);
+    }
 }
 
 void app_main(void) {
@@ -273,6 +397,8 @@ void app_main(void) {
         .lcd_param_bits = 8,
         .spi_mode = 0,
         .trans_queue_depth = 10,
+        .on_color_trans_done = lvgl_flush_done_cb,
+        .user_ctx = &disp_drv,
     };
     ESP_ERROR_CHECK(esp_lcd_new_panel_io_spi((esp_lcd_spi_bus_handle_t)LCD_HOST, &io_config, &io_handle));
 
@@ -311,9 +437,25 @@ void app_main(void) {
     disp_drv.hor_res = LCD_H_RES;
     disp_drv.ver_res = LCD_V_RES;
     disp_drv.flush_cb = lvgl_flush_cb;
+    disp_drv.wait_cb = lvgl_wait_cb;
     disp_drv.draw_buf = &disp_buf;
     disp_drv.user_data = panel_handle;
-    lv_disp_drv_register(&disp_drv);
+    lv_disp_t *disp = lv_disp_drv_register(&disp_drv);
+
+    // Redraws come only from invalidation through the display's refresh timer
+    lv_timer_set_cb(disp->refr_timer, lvgl_refr_timer_cb);
+#if CONFIG_CHESSMATE_LCD_MAX_FPS
+    lv_timer_set_period(disp->refr_timer, 1000 / CONFIG_CHESSMATE_LCD_MAX_FPS);
+#endif
+
+    ESP_LOGI(TAG, "Install LVGL tick timer");
+    const esp_timer_create_args_t lvgl_tick_timer_args = {
+        .callback = lvgl_tick_cb,
+        .name = "lvgl_tick"
+    };
+    esp_timer_handle_t lvgl_tick_timer = NULL;
+    ESP_ERROR_CHECK(esp_timer_create(&lvgl_tick_timer_args, &lvgl_tick_timer));
+    ESP_ERROR_CHECK(esp_timer_start_periodic(lvgl_tick_timer, LVGL_TICK_PERIOD_MS * 1000));
 
     ESP_LOGI(TAG, "Initialize buttons");
     gpio_config_t io_conf = {
@@ -344,9 +486,28 @@ void app_main(void) {
     menu_stack_top = -1;
 
     ESP_LOGI(TAG, "Create GUI");
-    lv_disp_t *disp = lv_disp_get_default();
     example_lvgl_demo_ui(disp);
 
+    ESP_LOGI(TAG, "Initialize LEDs");
+    led_display_init();
+
+#if CONFIG_CHESSMATE_ENGINE_BENCH
+    attack_bench_t bench;
+    engine_bench_attack_maps(200, &bench);
+    ESP_LOGI(TAG, "Engine bench: %lu moves, make+unmake %lld ns/move (%lld ns with the maps off), maps from scratch %lld ns, %lu mismatches",
+             (unsigned long)bench.moves, bench.make_unmake_us * 1000 / bench.moves,
+             bench.plain_us * 1000 / bench.moves, bench.recompute_us * 1000 / bench.moves,
+             (unsigned long)bench.mismatches);
+
+    led_bench_t led_bench;
+    led_display_bench(50, &led_bench);
+    ESP_LOGI(TAG, "LED bench: encode %lld ns from tables, %lld ns per bit, commit to wire done %lld us (wire %lld us), %lu mismatches",
+             led_bench.encode_ns, led_bench.encode_per_bit_ns, led_bench.commit_ns / 1000, led_bench.wire_us,
+             (unsigned long)led_bench.mismatches);
+#endif
+    // The benchmark drives the LEDs itself, so the frame clock starts after it
+    led_scheduler_start();
+
     ESP_LOGI(TAG, "Create tasks");
     xTaskCreate(button_task, "button_task", 4096, NULL, 10, NULL);
     xTaskCreate(timer_task, "timer_task", 4096, NULL, 10, NULL);
@@ -361,20 +522,12 @@ void app_main(void) {
 
     ESP_LOGI(TAG, "Enter main loop");
     while (1) {
-        // Run LVGL tick and task handler
+        // Run LVGL timers; the display redraws whatever the menu invalidated
+        lvgl_lock();
         lv_timer_handler();
-        
-        // Update display periodically
-        static uint32_t last_tick = 0;
-        if (lv_tick_get() - last_tick > 100) {  // Every 100ms
-            const char* current_items[MAX_MENU_DEPTH * 10];
-            for (int i = 0; i < current_menu_size; i++) {
-                current_items[i] = current_menu[i].name;
-            }
-            update_menu(current_items, current_menu_size, selected_index);
-            last_tick = lv_tick_get();
-        }
-        
+        lvgl_unlock();
+        log_lcd_stats();
+
         vTaskDelay(pdMS_TO_TICKS(10));
     }
 }